@@ -5,6 +5,7 @@ Scans for servos, then dispatches OSC messages targeted at those servos.
 #include <Dynamixel2Arduino.h>
 #include <Ethernet.h>
 #include <EthernetUdp.h>
+#include <OSCBundle.h>
 #include <OSCMessage.h>
 #include <SPI.h>
 
@@ -44,6 +45,23 @@ void loop() {
   int len = Udp.read(buf, sizeof(buf));
   if (len <= 0) return;
 
+  // The show sends each tick's updates as one bundle, kept under 512 bytes to fit buf.
+  // Plain messages still work too.
+  if (buf[0] == '#') {
+    OSCBundle bundle;
+    bundle.fill(buf, len);
+
+    if (!bundle.hasError()) {
+      bundle.route("/cg/ff/rot", onFlowerRot);
+    }
+    else {
+      OSCErrorCode e = bundle.getError();
+      DEBUG_SERIAL.print("OSC bundle error: ");
+      DEBUG_SERIAL.println((int)e);
+    }
+    return;
+  }
+
   OSCMessage msg;
   msg.fill(buf, len);
 
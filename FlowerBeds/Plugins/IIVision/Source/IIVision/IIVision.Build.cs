@@ -16,5 +16,9 @@ public class IIVision : ModuleRules
             "RenderCore",
             "RHI"
         ]);
+
+        PrivateDependencyModuleNames.AddRange([
+            "Json"
+        ]);
     }
 }
@@ -1,20 +1,57 @@
 #include "IIVision/BlobTracker.h"
 
+#include "IIVision/DepthKernels.h"
 #include "IIVision/IIVisionModule.h"
+#include "IIVision/MultiObjectTracker.h"
+#include "IIVision/RunLabeller.h"
+
+#include "Async/ParallelFor.h"
 
 namespace II::Vision
 {
+	struct FBlobTracker::FRowSweep
+	{
+		TArray<uint8> RowBuffer{};
+		TArray<uint64> SubtractedRing{};
+		TArray<uint64> FilteredRing{};
+		TArray<uint64> OutputRow{};
+		TArray<uint64> ZeroRow{};
+		FRunLabeller Labeller{};
+	};
+	
+	FBlobTracker::FBlobTracker()
+		: Labeller(MakeUnique<FRunLabeller>())
+		, MultiObjectTracker(MakeUnique<FMultiObjectTracker>())
+	{
+		MultiObjectTracker->Configure(FTrackingConfig{});
+	}
+
+	// Out of line so TUniquePtr can see the whole FRunLabeller and FMultiObjectTracker
+	FBlobTracker::~FBlobTracker()
+	{
+		// The task works on our arrays
+		WaitForBackgroundAdapt();
+	}
+
 	void FBlobTracker::BeginCalibration(int32 NumCalibrationFrames, int32 InWidth, int32 InHeight)
 	{
-		// Invalidate state
-		BackgroundDepthMm.Reset();
-		ValidMask.Reset();
+		WaitForBackgroundAdapt();
 		
-		// Reserve calibration frame space
-		NumCalibrationFramesRemaining = FMath::Max(1, NumCalibrationFrames);
+		NumCalibrationFramesTotal = FMath::Max(1, NumCalibrationFrames);
+		NumCalibrationFramesRemaining = NumCalibrationFramesTotal;
 		this->Width = FMath::Max(1, InWidth);
 		this->Height = FMath::Max(1, InHeight);
-		CalibrationFrames.Reset(NumCalibrationFrames * InWidth * InHeight);
+		
+		// Invalidate state. Zero samples marks every pixel's model as uninitialised.
+		const int32 NumPixels = Width * Height;
+		ModelDepthMm.SetNumZeroed(NumPixels);
+		ModelStepMm.SetNumZeroed(NumPixels);
+		NumModelSamples.SetNumZeroed(NumPixels);
+		Background.DepthMm.SetNumZeroed(NumPixels);
+		Background.ValidMask.SetNumZeroed(NumPixels);
+		Background.ForegroundMaxDepthMm.SetNumZeroed(NumPixels);
+		++BackgroundVersion;
+		MultiObjectTracker->Reset();
 		
 		CalibrationState = ECalibrationState::CalibrationInProgress;
 	}
@@ -39,12 +76,13 @@ namespace II::Vision
 			return;
 		}
 		
-		// Copy the frame data into the calibration buffer
-		check(Frame.Data->Num() == Width * Height * sizeof(uint16));
-		const auto SrcPtr = Frame.Data->GetData();
-		const auto DstPtr = CalibrationFrames.GetData() + CalibrationFrames.Num();
-		CalibrationFrames.AddUninitialized(Width * Height);
-		FMemory::Memcpy(DstPtr, SrcPtr, Width * Height * sizeof(uint16));
+		check(Frame.DepthMm.Num() == Width * Height);
+		const uint16* DepthMm = Frame.DepthMm.GetData();
+		
+		ParallelFor(Height, [this, DepthMm](const int32 Y)
+		{
+			FoldRowIntoBackground(Y, DepthMm, CalibrationConfig.CalibrationMaxStepMM, nullptr);
+		});
 		
 		if (--NumCalibrationFramesRemaining <= 0)
 		{
@@ -57,6 +95,19 @@ namespace II::Vision
 		return CalibrationState;
 	}
 
+	float FBlobTracker::GetCalibrationProgress() const
+	{
+		switch (CalibrationState)
+		{
+		case ECalibrationState::CalibrationInProgress:
+			return 1.0f - static_cast<float>(NumCalibrationFramesRemaining) / NumCalibrationFramesTotal;
+		case ECalibrationState::Calibrated:
+			return 1.0f;
+		default:
+			return 0.0f;
+		}
+	}
+
 	int32 FBlobTracker::GetWidth() const
 	{
 		return Width;
@@ -69,17 +120,45 @@ namespace II::Vision
 
 	const TArray<uint16>& FBlobTracker::GetBackgroundDepthMm() const
 	{
-		return BackgroundDepthMm;
+		return Background.DepthMm;
 	}
 	
 	const TArray<bool>& FBlobTracker::GetValidMask() const
 	{
-		return ValidMask;
+		return Background.ValidMask;
+	}
+
+	uint32 FBlobTracker::GetBackgroundVersion() const
+	{
+		return BackgroundVersion;
 	}
 
 	void FBlobTracker::ConfigureDetection(FDetectionConfig Config)
 	{
+		// The thresholds depend on the config, so make sure the task isn't still writing some with the old one
+		WaitForBackgroundAdapt();
+		
 		DetectionConfig = MoveTemp(Config);
+		
+		if (CalibrationState == ECalibrationState::Calibrated)
+		{
+			Kernels::ComputeForegroundMaxDepth(
+				Background.DepthMm.GetData(),
+				Background.ValidMask.GetData(),
+				Background.ForegroundMaxDepthMm.GetData(),
+				Width * Height,
+				MakeSubtractBackgroundParams());
+		}
+	}
+
+	void FBlobTracker::ConfigureTracking(const FTrackingConfig& Config)
+	{
+		MultiObjectTracker->Configure(Config);
+	}
+
+	const FBlobTracker::FStageTimings& FBlobTracker::GetLastStageTimings() const
+	{
+		return StageTimings;
 	}
 
 	void FBlobTracker::FBlob2D::AddPixel(const int32 X, const int32 Y)
@@ -93,6 +172,29 @@ namespace II::Vision
 		SumY += Y;
 	}
 
+	void FBlobTracker::FBlob2D::AddRun(const int32 X0, const int32 X1, const int32 Y)
+	{
+		const int32 NumPixels = X1 - X0 + 1;
+		PixelCount += NumPixels;
+		MinX = FMath::Min(MinX, X0);
+		MaxX = FMath::Max(MaxX, X1);
+		MinY = FMath::Min(MinY, Y);
+		MaxY = FMath::Max(MaxY, Y);
+		SumX += static_cast<int64>(X0 + X1) * NumPixels / 2;
+		SumY += static_cast<int64>(Y) * NumPixels;
+	}
+
+	void FBlobTracker::FBlob2D::Merge(const FBlob2D& Other)
+	{
+		PixelCount += Other.PixelCount;
+		MinX = FMath::Min(MinX, Other.MinX);
+		MaxX = FMath::Max(MaxX, Other.MaxX);
+		MinY = FMath::Min(MinY, Other.MinY);
+		MaxY = FMath::Max(MaxY, Other.MaxY);
+		SumX += Other.SumX;
+		SumY += Other.SumY;
+	}
+
 	FVector2f FBlobTracker::FBlob2D::GetCentroid() const
 	{
 		const float Inv = PixelCount > 0 ? 1.0f / PixelCount : 0.0f;
@@ -121,8 +223,19 @@ namespace II::Vision
 		};
 	}
 
+	FBlobTracker::FBlob3D FBlobTracker::FTrack::PredictAt(const uint64 InTimestampUs) const
+	{
+		const double DeltaSeconds = static_cast<double>(static_cast<int64>(InTimestampUs - TimestampUs)) * 1e-6;
+		
+		FBlob3D Predicted = Blob;
+		Predicted.CamPosMeters += CamVelocityMetersPerSec * DeltaSeconds;
+		return Predicted;
+	}
+
 	void FBlobTracker::Detect(const FFramePacket& Frame, FDetectionResult& OutResult)
 	{
+		OutResult.TimestampUs = Frame.TimestampUs;
+		
 		if (CalibrationState != ECalibrationState::Calibrated)
 		{
 			UE_LOG(LogIIVision, Warning, TEXT("Blob detection called before calibration complete"));
@@ -131,6 +244,8 @@ namespace II::Vision
 		
 		const int32 NumPixels = Width * Height;
 		
+		SwapInAdaptedBackground();
+		
 		// Ensure we're working with the same size frame
 		{
 			const bool bIsSameSize = Frame.Width == Width && Frame.Height == Height;
@@ -141,217 +256,398 @@ namespace II::Vision
 				return;
 			}
 			
-			const bool bDataIsSameSize = Frame.Data->Num() == NumPixels * sizeof(uint16);
+			const bool bDataIsSameSize = Frame.DepthMm.Num() == NumPixels;
 			
 			if (!bDataIsSameSize)
 			{
-				UE_LOG(LogIIVision, Warning, TEXT("Frame data size mismatch. Expected %llu bytes, got %d"), NumPixels * sizeof(uint16), Frame.Data->Num());
+				UE_LOG(LogIIVision, Warning, TEXT("Frame data size mismatch. Expected %d pixels, got %d"), NumPixels, Frame.DepthMm.Num());
 				return;
 			}
 		}
 		
-		// Subtract the background to get the valid foreground
-		SubtractBackground(Frame, OutResult);
+		// Time each stage as it finishes
+		StageTimings = {};
+		uint64 LapStartCycles = FPlatformTime::Cycles64();
+		
+		const auto Lap = [&LapStartCycles](double& OutSeconds)
+		{
+			const uint64 NowCycles = FPlatformTime::Cycles64();
+			OutSeconds = FPlatformTime::ToSeconds64(NowCycles - LapStartCycles);
+			LapStartCycles = NowCycles;
+		};
 		
-		// Despeckle
-		ForegroundScratchBuffer.SetNumUninitialized(NumPixels);
-		MajorityFilter(OutResult.Foreground, ForegroundScratchBuffer);
-		MajorityFilter(ForegroundScratchBuffer, OutResult.Foreground);
+		if (DetectionConfig.NumParallelBands > 1)
+		{
+			DetectFused(Frame, FMath::Min(DetectionConfig.NumParallelBands, Height), OutResult);
+			Lap(StageTimings.FusedSweep);
+		}
+		else if (DetectionConfig.bFusedPipeline)
+		{
+			DetectFused(Frame, 1, OutResult);
+			Lap(StageTimings.FusedSweep);
+		}
+		else
+		{
+			// Subtract the background to get the valid foreground
+			SubtractBackground(Frame, OutResult);
+			Lap(StageTimings.SubtractBackground);
+			
+			// Despeckle on a bit-packed copy of the mask
+			PackMask(OutResult.Foreground, PackedForeground);
+			MajorityFilter(PackedForeground, PackedForegroundScratchBuffer);
+			MajorityFilter(PackedForegroundScratchBuffer, PackedForeground);
+			UnpackMask(PackedForeground, OutResult.Foreground);
+			Lap(StageTimings.MajorityFilter);
+			
+			// Find blobs
+			ExtractBlobs(PackedForeground, OutResult);
+			Lap(StageTimings.ExtractBlobs);
+		}
 		
-		// Find blobs
-		ExtractBlobs(OutResult.Foreground, OutResult.ScreenSpaceBlobs);
 		Compute3DBlobs(Frame, OutResult.ScreenSpaceBlobs, OutResult.WorldSpaceBlobs);
+		Lap(StageTimings.Compute3DBlobs);
+		
+		MultiObjectTracker->Update(OutResult.WorldSpaceBlobs, Frame.TimestampUs, OutResult.Tracks);
+		Lap(StageTimings.Tracking);
+		
+		// Only adapt every so often, and never queue up behind a task that's still going
+		AdaptCredit = FMath::Min(AdaptCredit + DetectionConfig.BackgroundLearningRate, 1.0f);
+		
+		if (AdaptCredit >= 1.0f && AdaptTask.IsCompleted())
+		{
+			AdaptCredit -= 1.0f;
+			LaunchBackgroundAdapt(Frame);
+		}
 	}
 
 	void FBlobTracker::EndCalibration()
 	{
-		ComputeBackground();
-		CalibrationFrames.Empty();
+		WriteBackground(MakeSubtractBackgroundParams(), Background);
+		++BackgroundVersion;
+		
+		CalibrationState = ECalibrationState::Calibrated;
 	}
 
-	void FBlobTracker::ComputeBackground()
+	void FBlobTracker::FoldRowIntoBackground(
+		const int32 Y,
+		const uint16* DepthMm,
+		const uint16 MaxStepMm,
+		const uint64* ExcludeMask)
+	{
+		const Kernels::FBackgroundModelParams Params{
+			CalibrationConfig.MinDepthMM,
+			CalibrationConfig.MaxDepthMM,
+			MaxStepMm
+		};
+		
+		const int32 RowBegin = Y * Width;
+		
+		Kernels::UpdateBackgroundModel(
+			DepthMm + RowBegin,
+			ModelDepthMm.GetData() + RowBegin,
+			ModelStepMm.GetData() + RowBegin,
+			NumModelSamples.GetData() + RowBegin,
+			ExcludeMask ? ExcludeMask + Y * Kernels::GetNumMaskWords(Width) : nullptr,
+			Width,
+			Params);
+	}
+
+	void FBlobTracker::WriteBackground(const Kernels::FSubtractBackgroundParams& Params, FBackground& OutBackground) const
 	{
 		const int32 NumPixels = Width * Height;
-		const int32 NumCalibrationFrames = CalibrationFrames.Num() / NumPixels;
-	
-		uint16 Samples[MaxCalibrationFrames];
-	
-		BackgroundDepthMm.SetNumUninitialized(NumPixels);
-		ValidMask.SetNumUninitialized(NumPixels);
-	
-		for (int32 PixelIdx = 0; PixelIdx < NumPixels; ++PixelIdx)
-		{
-			int32 NumValidSamples = 0;
 		
-			for (int32 FrameIdx = 0; FrameIdx < NumCalibrationFrames; ++FrameIdx)
-			{
-				const int32 SampleIdx = PixelIdx + FrameIdx * NumPixels;
-				const uint16 DepthMm = CalibrationFrames[SampleIdx];
-				if (DepthMm >= CalibrationConfig.MinDepthMM && DepthMm <= CalibrationConfig.MaxDepthMM)
-				{
-					Samples[NumValidSamples++] = DepthMm;
-				}
-			}
+		OutBackground.DepthMm.SetNumUninitialized(NumPixels);
+		OutBackground.ValidMask.SetNumUninitialized(NumPixels);
+		OutBackground.ForegroundMaxDepthMm.SetNumUninitialized(NumPixels);
 		
-			if (NumValidSamples >= MinFramesValid)
-			{
-				// Find the median of the valid samples
-				std::nth_element(Samples, Samples + NumValidSamples / 2, Samples + NumValidSamples);
-				BackgroundDepthMm[PixelIdx] = Samples[NumValidSamples / 2]; 
-				ValidMask[PixelIdx] = true;
-			}
-			else
-			{
-				BackgroundDepthMm[PixelIdx] = 0;
-				ValidMask[PixelIdx] = false;
-			}
+		for (int32 PixelIdx = 0; PixelIdx < NumPixels; ++PixelIdx)
+		{
+			const bool bValid = NumModelSamples[PixelIdx] >= MinFramesValid;
+			OutBackground.DepthMm[PixelIdx] = bValid ? ModelDepthMm[PixelIdx] : 0;
+			OutBackground.ValidMask[PixelIdx] = bValid;
 		}
 		
-		CalibrationState = ECalibrationState::Calibrated;
+		Kernels::ComputeForegroundMaxDepth(
+			OutBackground.DepthMm.GetData(),
+			OutBackground.ValidMask.GetData(),
+			OutBackground.ForegroundMaxDepthMm.GetData(),
+			NumPixels,
+			Params);
 	}
 
-	void FBlobTracker::SubtractBackground(const FFramePacket& Frame, FDetectionResult& OutResult) const
+	void FBlobTracker::SwapInAdaptedBackground()
 	{
-		const int32 NumPixels = Width * Height;
+		// Nothing new until the task is done writing the back buffer
+		if (!AdaptTask.IsValid() || !AdaptTask.IsCompleted())
+		{
+			return;
+		}
 		
-		OutResult.Foreground.SetNumZeroed(NumPixels);
+		AdaptTask = {};
+		
+		Swap(Background, AdaptedBackground);
+		++BackgroundVersion;
+	}
+
+	void FBlobTracker::LaunchBackgroundAdapt(const FFramePacket& Frame)
+	{
+		// Mask off every pixel that ended up in a blob, so people who stand still don't get absorbed
+		const int32 NumMaskWords = Kernels::GetNumMaskWords(Width);
+		AdaptExcludeMask.SetNumZeroed(NumMaskWords * Height);
 		
-		for (int32 i = 0; i < NumPixels; ++i)
+		for (const FRunLabeller::FRun& Run : Labeller->GetRuns())
 		{
-			// Get the current depth for this pixel
-			const uint16 DepthMm = reinterpret_cast<uint16*>(Frame.Data->GetData())[i];
-			
-			// Out of range or invalid, skip
-			if (DepthMm < DetectionConfig.MinDepthMM || DepthMm > DetectionConfig.MaxDepthMM)
+			if (Labeller->GetBlobId(Run) == INDEX_NONE)
 			{
 				continue;
 			}
 			
-			// BG was valid, figure out if this pixel is foreground
-			if (ValidMask[i])
+			uint64* Row = AdaptExcludeMask.GetData() + Run.Y * NumMaskWords;
+			
+			for (int32 x = Run.X0; x <= Run.X1; ++x)
 			{
-				// Get the depth for the background
-				const uint16 BgDepthMm = BackgroundDepthMm[i];
-				
-				// If the bg is closer, skip
-				if (BgDepthMm <= DepthMm)
+				Row[x / 64] |= 1ull << (x % 64);
+			}
+		}
+		
+		// Hold on to the frame data ourselves, the caller's free to let go of it once we return
+		AdaptTask = UE::Tasks::Launch(
+			UE_SOURCE_LOCATION, 
+			[
+				this, 
+				DataOwner = Frame.DataOwner, 
+				DepthMm = Frame.DepthMm.GetData(), 
+				MaxStepMm = DetectionConfig.BackgroundAdaptMaxStepMM, 
+				Params = MakeSubtractBackgroundParams()
+			]
+			{
+				for (int32 Y = 0; Y < Height; ++Y)
 				{
-					continue;
+					FoldRowIntoBackground(Y, DepthMm, MaxStepMm, AdaptExcludeMask.GetData());
 				}
 				
-				const uint16 Delta = BgDepthMm - DepthMm;
-				
-				if (Delta > DetectionConfig.DepthDeltaMM)
-				{
-					OutResult.Foreground[i] = TNumericLimits<uint8>::Max();
-				}
-			}
-			// BG was invalid, so this pixel is probably foreground
-			else
-			{
-				OutResult.Foreground[i] = TNumericLimits<uint8>::Max();
-			}
+				WriteBackground(Params, AdaptedBackground);
+			},
+			UE::Tasks::ETaskPriority::BackgroundNormal);
+	}
+
+	void FBlobTracker::WaitForBackgroundAdapt()
+	{
+		if (AdaptTask.IsValid())
+		{
+			AdaptTask.Wait();
+			SwapInAdaptedBackground();
 		}
 	}
 
-	void FBlobTracker::MajorityFilter(const TArray<uint8>& Src, TArray<uint8>& Dst) const
+	Kernels::FSubtractBackgroundParams FBlobTracker::MakeSubtractBackgroundParams() const
+	{
+		Kernels::FSubtractBackgroundParams Params;
+		Params.MinDepthMm = DetectionConfig.MinDepthMM;
+		Params.MaxDepthMm = DetectionConfig.MaxDepthMM;
+		
+		// A negative delta means anything in front of the background, which is the same as a delta of 0
+		Params.DepthDeltaMm = static_cast<uint16>(FMath::Clamp<int32>(DetectionConfig.DepthDeltaMM, 0, TNumericLimits<uint16>::Max()));
+		
+		return Params;
+	}
+
+	void FBlobTracker::SubtractBackground(const FFramePacket& Frame, FDetectionResult& OutResult) const
 	{
-		for (int y = 0; y < Height; ++y)
+		const int32 NumPixels = Width * Height;
+		
+		OutResult.Foreground.SetNumUninitialized(NumPixels);
+		
+		Kernels::SubtractBackground(
+			Frame.DepthMm.GetData(),
+			Background.ForegroundMaxDepthMm.GetData(),
+			OutResult.Foreground.GetData(),
+			NumPixels,
+			Kernels::GetForegroundMinDepth(MakeSubtractBackgroundParams()));
+	}
+
+	void FBlobTracker::PackMask(const TArray<uint8>& Src, TArray<uint64>& Dst) const
+	{
+		const int32 NumMaskWords = Kernels::GetNumMaskWords(Width);
+		Dst.SetNumUninitialized((Height + 2) * NumMaskWords);
+		
+		// Zero the padding rows
+		FMemory::Memzero(Dst.GetData(), NumMaskWords * sizeof(uint64));
+		FMemory::Memzero(Dst.GetData() + (Height + 1) * NumMaskWords, NumMaskWords * sizeof(uint64));
+		
+		for (int32 y = 0; y < Height; ++y)
 		{
-			for (int x = 0; x < Width; ++x)
-			{
-				int NumValid = 0;
-				
-				for (int dy = -1; dy <= 1; ++dy)
-				{
-					for (int dx = -1; dx <= 1; ++dx)
-					{
-						const int yTest = y + dy;
-						const int xTest = x + dx;
-						
-						if (yTest < 0 || yTest >= Height || xTest < 0 || xTest >= Width)
-						{
-							continue;
-						}
-						
-						if (Src[yTest * Width + xTest] > 0)
-						{
-							++NumValid;
-						}
-					}
-				}
-				
-				Dst[y * Width + x] = NumValid >= 5 ? TNumericLimits<uint8>::Max() : 0;
-			}
+			Kernels::PackMaskRow(Src.GetData() + y * Width, Dst.GetData() + (y + 1) * NumMaskWords, Width);
 		}
 	}
 
-	void FBlobTracker::ExtractBlobs(const TArray<uint8>& Foreground, TArray<FBlob2D>& OutBlobs) const
+	void FBlobTracker::UnpackMask(const TArray<uint64>& Src, TArray<uint8>& Dst) const
 	{
-		TBitArray Visited(false, Width * Height);
-		TArray<int32> Queue;
-		Queue.Reserve(4096); // TODO: figure out max valid blob size
+		const int32 NumMaskWords = Kernels::GetNumMaskWords(Width);
 		
-		const auto IsFg = [&Foreground](const int32 Idx)
+		for (int32 y = 0; y < Height; ++y)
 		{
-			return Foreground[Idx] > 0;
-		};
+			Kernels::UnpackMaskRow(Src.GetData() + (y + 1) * NumMaskWords, Dst.GetData() + y * Width, Width);
+		}
+	}
+
+	void FBlobTracker::MajorityFilter(const TArray<uint64>& Src, TArray<uint64>& Dst) const
+	{
+		const int32 NumMaskWords = Kernels::GetNumMaskWords(Width);
+		Dst.SetNumUninitialized(Src.Num());
+		
+		// Zero the padding rows
+		FMemory::Memzero(Dst.GetData(), NumMaskWords * sizeof(uint64));
+		FMemory::Memzero(Dst.GetData() + (Height + 1) * NumMaskWords, NumMaskWords * sizeof(uint64));
 		
-		const auto TryEnqueueNeighbor = [&Visited, &Queue, &IsFg, Width = Width, Height = Height](const int32 X, const int32 Y)
+		// Row y of the image is row y + 1 of the buffer, so its neighbours are always in bounds
+		for (int32 y = 1; y <= Height; ++y)
 		{
-			if (X < 0 || X >= Width || Y < 0 || Y >= Height)
-			{
-				return;
-			}
+			Kernels::MajorityFilterRow(
+				Src.GetData() + (y - 1) * NumMaskWords,
+				Src.GetData() + y * NumMaskWords,
+				Src.GetData() + (y + 1) * NumMaskWords,
+				Dst.GetData() + y * NumMaskWords,
+				Width);
+		}
+	}
+
+	void FBlobTracker::ExtractBlobs(const TArray<uint64>& Mask, FDetectionResult& OutResult)
+	{
+		const int32 NumMaskWords = Kernels::GetNumMaskWords(Width);
+		
+		Labeller->Reset(Width);
+		
+		// Skip the padding row at the top
+		for (int32 y = 0; y < Height; ++y)
+		{
+			Labeller->AddRow(y, Mask.GetData() + (y + 1) * NumMaskWords);
+		}
+		
+		Labeller->Finish(DetectionConfig.MinBlobPixels, OutResult.ScreenSpaceBlobs);
+		Labeller->PaintLabels(Height, OutResult.Labels);
+	}
 
-			if (const int32 Idx = Y * Width + X; !Visited[Idx] && IsFg(Idx))
+	void FBlobTracker::PrepareRowSweeps(const int32 NumSweeps)
+	{
+		const int32 NumMaskWords = Kernels::GetNumMaskWords(Width);
+		
+		while (RowSweeps.Num() < NumSweeps)
+		{
+			RowSweeps.Emplace(MakeUnique<FRowSweep>());
+		}
+		
+		for (int32 SweepIdx = 0; SweepIdx < NumSweeps; ++SweepIdx)
+		{
+			FRowSweep& Sweep = *RowSweeps[SweepIdx];
+			Sweep.RowBuffer.SetNumUninitialized(Width);
+			Sweep.SubtractedRing.SetNumUninitialized(3 * NumMaskWords);
+			Sweep.FilteredRing.SetNumUninitialized(3 * NumMaskWords);
+			Sweep.OutputRow.SetNumUninitialized(NumMaskWords);
+			Sweep.ZeroRow.SetNumZeroed(NumMaskWords);
+			Sweep.Labeller.Reset(Width);
+		}
+	}
+
+	void FBlobTracker::DetectFused(const FFramePacket& Frame, const int32 NumBands, FDetectionResult& OutResult)
+	{
+		OutResult.Foreground.SetNumUninitialized(Width * Height);
+		
+		PrepareRowSweeps(NumBands);
+		
+		if (NumBands == 1)
+		{
+			SweepRows(Frame, 0, Height, *RowSweeps[0], OutResult);
+			Swap(*Labeller, RowSweeps[0]->Labeller);
+		}
+		else
+		{
+			const int32 RowsPerBand = FMath::DivideAndRoundUp(Height, NumBands);
+			
+			// Each band writes only its own rows of the output, and recomputes the 2 rows either side of it that the
+			// filters need rather than waiting for its neighbours
+			ParallelFor(NumBands, [this, &Frame, &OutResult, RowsPerBand](const int32 BandIdx)
 			{
-				Visited[Idx] = true;
-				Queue.Add(Idx);
+				const int32 BeginY = FMath::Min(BandIdx * RowsPerBand, Height);
+				const int32 EndY = FMath::Min(BeginY + RowsPerBand, Height);
+				SweepRows(Frame, BeginY, EndY, *RowSweeps[BandIdx], OutResult);
+			});
+			
+			// Stitch the bands together top to bottom, so labels (and so blobs) stay in raster order
+			Labeller->Reset(Width);
+			
+			for (int32 BandIdx = 0; BandIdx < NumBands; ++BandIdx)
+			{
+				Labeller->Append(RowSweeps[BandIdx]->Labeller);
 			}
+		}
+		
+		Labeller->Finish(DetectionConfig.MinBlobPixels, OutResult.ScreenSpaceBlobs);
+		Labeller->PaintLabels(Height, OutResult.Labels);
+	}
+
+	void FBlobTracker::SweepRows(
+		const FFramePacket& Frame,
+		const int32 BeginY,
+		const int32 EndY,
+		FRowSweep& Sweep,
+		FDetectionResult& OutResult) const
+	{
+		// Row y of the final mask needs rows y-1..y+1 of the first filter pass, which need rows y-2..y+2 of the
+		// subtracted mask. So we run each stage 1 row behind the one before it, keeping the last 3 rows of each
+		// stage in a ring, and start 2 rows early and finish 2 rows late. Rows outside the image read as the zero
+		// row.
+		const int32 NumMaskWords = Kernels::GetNumMaskWords(Width);
+		const uint16 FgMinDepthMm = Kernels::GetForegroundMinDepth(MakeSubtractBackgroundParams());
+		const uint16* DepthMm = Frame.DepthMm.GetData();
+		
+		const auto GetRingRow = [this, &Sweep, NumMaskWords](TArray<uint64>& Ring, const int32 y) -> uint64*
+		{
+			return y < 0 || y >= Height ? Sweep.ZeroRow.GetData() : Ring.GetData() + (y % 3) * NumMaskWords;
 		};
 		
-		for (int y = 1; y < Height - 1; ++y)
+		for (int32 y = BeginY - 2; y < EndY + 2; ++y)
 		{
-			for (int x = 1; x < Width - 1; ++x)
+			// Subtract and pack row y
+			if (y >= 0 && y < Height)
 			{
-				const int32 StartIdx = y * Width + x;
-				
-				if (Visited[StartIdx] || !IsFg(StartIdx))
-				{
-					continue;
-				}
+				const int32 RowOffset = y * Width;
 				
-				// New blob
-				FBlob2D Blob;
-				Blob.Id = OutBlobs.Num();
+				Kernels::SubtractBackground(
+					DepthMm + RowOffset,
+					Background.ForegroundMaxDepthMm.GetData() + RowOffset,
+					Sweep.RowBuffer.GetData(),
+					Width,
+					FgMinDepthMm);
 				
-				Queue.Reset();
-				Queue.Add(StartIdx);
-				Visited[StartIdx] = true;
+				Kernels::PackMaskRow(Sweep.RowBuffer.GetData(), GetRingRow(Sweep.SubtractedRing, y), Width);
+			}
+			
+			// First filter pass on row y - 1
+			if (const int32 FilteredY = y - 1; FilteredY >= FMath::Max(BeginY - 1, 0) && FilteredY < FMath::Min(EndY + 1, Height))
+			{
+				Kernels::MajorityFilterRow(
+					GetRingRow(Sweep.SubtractedRing, FilteredY - 1),
+					GetRingRow(Sweep.SubtractedRing, FilteredY),
+					GetRingRow(Sweep.SubtractedRing, FilteredY + 1),
+					GetRingRow(Sweep.FilteredRing, FilteredY),
+					Width);
+			}
+			
+			// Second filter pass on row y - 2, then emit it
+			if (const int32 OutY = y - 2; OutY >= BeginY)
+			{
+				uint64* OutRow = Sweep.OutputRow.GetData();
 				
-				while (!Queue.IsEmpty())
-				{
-					const int32 Idx = Queue.Pop(EAllowShrinking::No);
-					const int32 Cy = Idx / Width;
-					const int32 Cx = Idx % Width;
-					
-					Blob.AddPixel(Cx, Cy);
-					
-					// Get the 8 neighbors and add them to the blob if valid
-					for (int32 Dy = -1; Dy <= 1; ++Dy)
-					{
-						for (int32 Dx = -1; Dx <= 1; ++Dx)
-						{
-							TryEnqueueNeighbor(Cx + Dx, Cy + Dy);
-						}
-					}
-				}
+				Kernels::MajorityFilterRow(
+					GetRingRow(Sweep.FilteredRing, OutY - 1),
+					GetRingRow(Sweep.FilteredRing, OutY),
+					GetRingRow(Sweep.FilteredRing, OutY + 1),
+					OutRow,
+					Width);
 				
-				if (Blob.PixelCount >= DetectionConfig.MinBlobPixels)
-				{
-					OutBlobs.Emplace(MoveTemp(Blob));
-				}
+				Kernels::UnpackMaskRow(OutRow, OutResult.Foreground.GetData() + OutY * Width, Width);
+				Sweep.Labeller.AddRow(OutY, OutRow);
 			}
 		}
 	}
@@ -359,54 +655,99 @@ namespace II::Vision
 	void FBlobTracker::Compute3DBlobs(
 		const FFramePacket& Frame,
 		const TArray<FBlob2D>& ScreenSpaceBlobs, 
-		TArray<FBlob3D>& OutBlobs) const
+		TArray<FBlob3D>& OutBlobs)
 	{
-		OutBlobs.Reserve(ScreenSpaceBlobs.Num());
+		OutBlobs.Reset(ScreenSpaceBlobs.Num());
+		
+		const uint16* FrameDepthMm = Frame.DepthMm.GetData();
+		
+		UpdateRayTables(Frame.Intrinsics);
+		
+		// Bucket the labeller's runs by blob, so each blob only samples its own pixels rather than everything in its
+		// bbox, which would pull in the background and anyone overlapping it
+		const TArray<FRunLabeller::FRun>& Runs = Labeller->GetRuns();
+		BlobRunOffsets.Reset();
+		BlobRunOffsets.AddZeroed(ScreenSpaceBlobs.Num() + 1);
+		
+		for (const FRunLabeller::FRun& Run : Runs)
+		{
+			if (const int32 BlobId = Labeller->GetBlobId(Run); BlobId != INDEX_NONE)
+			{
+				++BlobRunOffsets[BlobId];
+			}
+		}
+		
+		// Now each offset is the end of its blob's runs, and the last one is the total
+		for (int32 BlobIdx = 1; BlobIdx <= ScreenSpaceBlobs.Num(); ++BlobIdx)
+		{
+			BlobRunOffsets[BlobIdx] += BlobRunOffsets[BlobIdx - 1];
+		}
+		
+		BlobRunIndices.Reset();
+		BlobRunIndices.AddUninitialized(BlobRunOffsets.Last());
+		
+		// Fill back to front, so each blob's runs stay in raster order and its offset ends up at its first run
+		for (int32 RunIdx = Runs.Num() - 1; RunIdx >= 0; --RunIdx)
+		{
+			if (const int32 BlobId = Labeller->GetBlobId(Runs[RunIdx]); BlobId != INDEX_NONE)
+			{
+				BlobRunIndices[--BlobRunOffsets[BlobId]] = RunIdx;
+			}
+		}
+		
+		const int32 Stride = FMath::Max(1, DetectionConfig.StridePixels);
 		
 		for (const FBlob2D& ScreenSpaceBlob : ScreenSpaceBlobs)
 		{
 			FBlob3D WorldBlob;
 			WorldBlob.Id = ScreenSpaceBlob.Id;
 			
-			const int32 MinX = FMath::Clamp(ScreenSpaceBlob.MinX, 0, Width - 1);
-			const int32 MaxX = FMath::Clamp(ScreenSpaceBlob.MaxX, 0, Width - 1);
-			const int32 MinY = FMath::Clamp(ScreenSpaceBlob.MinY, 0, Height - 1);
-			const int32 MaxY = FMath::Clamp(ScreenSpaceBlob.MaxY, 0, Height - 1);
-			
-			// Gather depths, skipping some pixels for speed
-			TArray<uint16> Depths;
-			const int32 BlobWidth = MaxX - MinX + 1;
-			const int32 BlobHeight = MaxY - MinY + 1;
-			Depths.Reserve((BlobWidth / DetectionConfig.StridePixels) * (BlobHeight / DetectionConfig.StridePixels));
+			// Gather samples, keeping to a grid of every Stride-th pixel for speed. The scratch arrays keep their
+			// allocations between blobs and frames.
+			BlobSamples.Reset();
 			
-			for (int32 y = MinY; y <= MaxY; y += DetectionConfig.StridePixels)
+			for (int32 Idx = BlobRunOffsets[ScreenSpaceBlob.Id]; Idx < BlobRunOffsets[ScreenSpaceBlob.Id + 1]; ++Idx)
 			{
-				const int32 Row = y * Width;
+				const FRunLabeller::FRun& Run = Runs[BlobRunIndices[Idx]];
+				
+				if (Run.Y % Stride != 0)
+				{
+					continue;
+				}
+				
+				const uint16* RowDepthMm = FrameDepthMm + Run.Y * Width;
 				
-				for (int32 x = MinX; x <= MaxX; x += DetectionConfig.StridePixels)
+				for (int32 x = FMath::DivideAndRoundUp(Run.X0, Stride) * Stride; x <= Run.X1; x += Stride)
 				{
-					const int32 Idx = Row + x;
-					const uint16 DepthMm = reinterpret_cast<uint16*>(Frame.Data->GetData())[Idx];
+					const uint16 DepthMm = RowDepthMm[x];
 					
 					if (DepthMm >= DetectionConfig.MinDepthMM && DepthMm <= DetectionConfig.MaxDepthMM)
 					{
-						Depths.Add(DepthMm);
+						BlobSamples.Add({ static_cast<uint16>(x), static_cast<uint16>(Run.Y), DepthMm });
 					}
 				}
 			}
 			
 			// Not enough samples in range
-			if (Depths.Num() < DetectionConfig.MinSamples)
+			if (BlobSamples.Num() < DetectionConfig.MinSamples)
 			{
 				continue;
 			}
 			
-			// Find the median depth
-			Depths.Sort();
-			const uint16 MedianDepthMm = Depths[Depths.Num() / 2];
+			// Find the median depth. MedianDepth reorders what it's given, so give it a copy.
+			BlobSampleDepths.Reset();
+			BlobSampleDepths.AddUninitialized(BlobSamples.Num());
+			
+			for (int32 SampleIdx = 0; SampleIdx < BlobSamples.Num(); ++SampleIdx)
+			{
+				BlobSampleDepths[SampleIdx] = BlobSamples[SampleIdx].DepthMm;
+			}
+			
+			const uint16 MedianDepthMm = Kernels::MedianDepth(BlobSampleDepths.GetData(), BlobSampleDepths.Num());
 			WorldBlob.MedianZMeters = MedianDepthMm * 0.001f;
 			
-			// Find the 3D points within the depth window
+			// Back-project the samples within the depth window, accumulating the mean and extents as we go. Only the
+			// gathered samples are visited, not the whole bbox again.
 			const int32 DepthMinMm = static_cast<int32>(MedianDepthMm) - DetectionConfig.ZWindowMm;
 			const int32 DepthMaxMm = static_cast<int32>(MedianDepthMm) + DetectionConfig.ZWindowMm;
 			
@@ -416,38 +757,21 @@ namespace II::Vision
 			FVector MinP(FLT_MAX, FLT_MAX, FLT_MAX);
 			FVector MaxP(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 			
-			for (int32 y = MinY; y <= MaxY; y += DetectionConfig.StridePixels)
+			for (const FDepthSample& Sample : BlobSamples)
 			{
-				const int32 Row = y * Width;
-				
-				for (int32 x = MinX; x <= MaxX; x += DetectionConfig.StridePixels)
+				if (Sample.DepthMm < DepthMinMm || Sample.DepthMm > DepthMaxMm)
 				{
-					const int32 Idx = Row + x;
-					const uint16 DepthMm = reinterpret_cast<uint16*>(Frame.Data->GetData())[Idx];
-					
-					if (DepthMm < DepthMinMm || DepthMm > DepthMaxMm 
-						|| DepthMm < DetectionConfig.MinDepthMM || DepthMm > DetectionConfig.MaxDepthMM)
-					{
-						continue;
-					}
-					
-					const float Z = DepthMm * 0.001f;
-					const FVector P{
-						(static_cast<float>(x) - Frame.Intrinsics.Cx) * Z / Frame.Intrinsics.Fx,
-						(static_cast<float>(y) - Frame.Intrinsics.Cy) * Z / Frame.Intrinsics.Fy,
-						Z
-					};
-					
-					Sum += P;
-					++NumValidPoints;
-					
-					MinP.X = FMath::Min(MinP.X, P.X);
-					MinP.Y = FMath::Min(MinP.Y, P.Y);
-					MinP.Z = FMath::Min(MinP.Z, P.Z);
-					MaxP.X = FMath::Max(MaxP.X, P.X);
-					MaxP.Y = FMath::Max(MaxP.Y, P.Y);
-					MaxP.Z = FMath::Max(MaxP.Z, P.Z);
+					continue;
 				}
+				
+				const float Z = Sample.DepthMm * 0.001f;
+				const FVector P{ RayX[Sample.X] * Z, RayY[Sample.Y] * Z, Z };
+				
+				Sum += P;
+				++NumValidPoints;
+				
+				MinP = MinP.ComponentMin(P);
+				MaxP = MaxP.ComponentMax(P);
 			}
 			
 			if (NumValidPoints < DetectionConfig.MinSamples / 2)
@@ -463,4 +787,72 @@ namespace II::Vision
 			OutBlobs.Emplace(MoveTemp(WorldBlob));
 		}
 	}
+
+	void FBlobTracker::ComputePointCloud(const FFramePacket& Frame, FPointCloud& OutPointCloud)
+	{
+		const int32 NumPixels = Frame.Width * Frame.Height;
+		
+		if (Frame.DepthMm.Num() != NumPixels)
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("Point cloud frame data size mismatch. Expected %d pixels, got %d"), NumPixels, Frame.DepthMm.Num());
+			return;
+		}
+		
+		// The tables are sized by the tracker's dimensions
+		if (Frame.Width != Width || Frame.Height != Height)
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("Point cloud frame size mismatch. Expected (%d, %d), got (%d, %d)"), Width, Height, Frame.Width, Frame.Height);
+			return;
+		}
+		
+		UpdateRayTables(Frame.Intrinsics);
+		
+		OutPointCloud.Width = Width;
+		OutPointCloud.Height = Height;
+		OutPointCloud.X.SetNumUninitialized(NumPixels);
+		OutPointCloud.Y.SetNumUninitialized(NumPixels);
+		OutPointCloud.Z.SetNumUninitialized(NumPixels);
+		
+		const uint16* DepthMm = Frame.DepthMm.GetData();
+		
+		ParallelFor(Height, [this, DepthMm, &OutPointCloud](const int32 Y)
+		{
+			const int32 RowOffset = Y * Width;
+			
+			Kernels::BackProjectRow(
+				DepthMm + RowOffset,
+				RayX.GetData(),
+				RayY[Y],
+				OutPointCloud.X.GetData() + RowOffset,
+				OutPointCloud.Y.GetData() + RowOffset,
+				OutPointCloud.Z.GetData() + RowOffset,
+				Width);
+		});
+	}
+
+	void FBlobTracker::UpdateRayTables(const FCameraIntrinsics& Intrinsics)
+	{
+		const bool bIsUpToDate = RayX.Num() == Width && RayY.Num() == Height
+			&& RayIntrinsics.Fx == Intrinsics.Fx && RayIntrinsics.Fy == Intrinsics.Fy
+			&& RayIntrinsics.Cx == Intrinsics.Cx && RayIntrinsics.Cy == Intrinsics.Cy;
+		
+		if (bIsUpToDate)
+		{
+			return;
+		}
+		
+		RayIntrinsics = Intrinsics;
+		RayX.SetNumUninitialized(Width);
+		RayY.SetNumUninitialized(Height);
+		
+		for (int32 x = 0; x < Width; ++x)
+		{
+			RayX[x] = (static_cast<float>(x) - Intrinsics.Cx) / Intrinsics.Fx;
+		}
+		
+		for (int32 y = 0; y < Height; ++y)
+		{
+			RayY[y] = (static_cast<float>(y) - Intrinsics.Cy) / Intrinsics.Fy;
+		}
+	}
 }
@@ -0,0 +1,500 @@
+#include "IIVision/DepthKernels.h"
+
+#define II_VISION_WITH_SSE2 (PLATFORM_CPU_X86_FAMILY && PLATFORM_ENABLE_VECTORINTRINSICS)
+#define II_VISION_WITH_NEON (PLATFORM_ENABLE_VECTORINTRINSICS_NEON)
+
+#if II_VISION_WITH_SSE2
+	#include <immintrin.h>
+
+	// MSVC lets us use AVX2 intrinsics anywhere, clang and gcc need the function to opt in
+	#if defined(__clang__) || defined(__GNUC__)
+		#define II_VISION_TARGET_AVX2 __attribute__((target("avx2")))
+	#else
+		#define II_VISION_TARGET_AVX2
+	#endif
+#elif II_VISION_WITH_NEON
+	#include <arm_neon.h>
+#endif
+
+namespace II::Vision::Kernels
+{
+	namespace
+	{
+		using FSubtractBackgroundFn = void(*)(const uint16*, const uint16*, uint8*, int32, int32, uint16);
+
+		/**
+		 * Scalar version, also used for the tail of the SIMD versions.
+		 * fg = MinDepth <= Depth <= FgMaxDepth
+		 */
+		void SubtractBackgroundScalar(
+			const uint16* DepthMm,
+			const uint16* FgMaxDepthMm,
+			uint8* OutForeground,
+			const int32 Begin,
+			const int32 End,
+			const uint16 FgMinDepthMm)
+		{
+			for (int32 i = Begin; i < End; ++i)
+			{
+				const uint16 Depth = DepthMm[i];
+				const bool bForeground = (Depth >= FgMinDepthMm) & (Depth <= FgMaxDepthMm[i]);
+				OutForeground[i] = static_cast<uint8>(-static_cast<int32>(bForeground));
+			}
+		}
+
+#if II_VISION_WITH_SSE2
+		/**
+		 * SSE2 has no unsigned 16-bit compares, so we use saturating subtraction instead:
+		 * A > B <=> subs_epu16(A, B) != 0
+		 */
+		FORCEINLINE __m128i SubtractBackground8Sse2(const __m128i Depth, const __m128i FgMaxDepth, const __m128i FgMinDepth)
+		{
+			const __m128i Outside = _mm_or_si128(_mm_subs_epu16(FgMinDepth, Depth), _mm_subs_epu16(Depth, FgMaxDepth));
+			return _mm_cmpeq_epi16(Outside, _mm_setzero_si128());
+		}
+
+		void SubtractBackgroundSse2(
+			const uint16* DepthMm,
+			const uint16* FgMaxDepthMm,
+			uint8* OutForeground,
+			const int32 Begin,
+			const int32 End,
+			const uint16 FgMinDepthMm)
+		{
+			const __m128i FgMinDepth = _mm_set1_epi16(static_cast<int16>(FgMinDepthMm));
+			
+			int32 i = Begin;
+			
+			// 16 pixels per iteration so the masks pack into a full register of bytes
+			for (; i + 16 <= End; i += 16)
+			{
+				const __m128i Fg0 = SubtractBackground8Sse2(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(DepthMm + i)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(FgMaxDepthMm + i)),
+					FgMinDepth);
+				
+				const __m128i Fg1 = SubtractBackground8Sse2(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(DepthMm + i + 8)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(FgMaxDepthMm + i + 8)),
+					FgMinDepth);
+				
+				// 0xFFFF/0x0000 lanes saturate to 0xFF/0x00 bytes
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(OutForeground + i), _mm_packs_epi16(Fg0, Fg1));
+			}
+			
+			SubtractBackgroundScalar(DepthMm, FgMaxDepthMm, OutForeground, i, End, FgMinDepthMm);
+		}
+
+		II_VISION_TARGET_AVX2 FORCEINLINE __m256i SubtractBackground16Avx2(
+			const uint16* DepthMm,
+			const uint16* FgMaxDepthMm,
+			const __m256i FgMinDepth)
+		{
+			const __m256i Depth = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(DepthMm));
+			const __m256i FgMaxDepth = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(FgMaxDepthMm));
+			const __m256i Outside = _mm256_or_si256(
+				_mm256_subs_epu16(FgMinDepth, Depth),
+				_mm256_subs_epu16(Depth, FgMaxDepth));
+			return _mm256_cmpeq_epi16(Outside, _mm256_setzero_si256());
+		}
+
+		II_VISION_TARGET_AVX2 void SubtractBackgroundAvx2(
+			const uint16* DepthMm,
+			const uint16* FgMaxDepthMm,
+			uint8* OutForeground,
+			const int32 Begin,
+			const int32 End,
+			const uint16 FgMinDepthMm)
+		{
+			const __m256i FgMinDepth = _mm256_set1_epi16(static_cast<int16>(FgMinDepthMm));
+			
+			int32 i = Begin;
+			
+			for (; i + 32 <= End; i += 32)
+			{
+				const __m256i Fg0 = SubtractBackground16Avx2(DepthMm + i, FgMaxDepthMm + i, FgMinDepth);
+				const __m256i Fg1 = SubtractBackground16Avx2(DepthMm + i + 16, FgMaxDepthMm + i + 16, FgMinDepth);
+				
+				// packs works per 128-bit lane, so put the 64-bit quarters back in pixel order
+				const __m256i Fg = _mm256_permute4x64_epi64(_mm256_packs_epi16(Fg0, Fg1), 0xD8);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(OutForeground + i), Fg);
+			}
+			
+			SubtractBackgroundSse2(DepthMm, FgMaxDepthMm, OutForeground, i, End, FgMinDepthMm);
+		}
+
+		bool HasAvx2()
+		{
+#if PLATFORM_WINDOWS
+			return FPlatformMisc::HasAVX2InstructionSupport();
+#elif defined(__clang__) || defined(__GNUC__)
+			return __builtin_cpu_supports("avx2");
+#else
+			return false;
+#endif
+		}
+#endif
+
+#if II_VISION_WITH_NEON
+		void SubtractBackgroundNeon(
+			const uint16* DepthMm,
+			const uint16* FgMaxDepthMm,
+			uint8* OutForeground,
+			const int32 Begin,
+			const int32 End,
+			const uint16 FgMinDepthMm)
+		{
+			const uint16x8_t FgMinDepth = vdupq_n_u16(FgMinDepthMm);
+			
+			int32 i = Begin;
+			
+			for (; i + 16 <= End; i += 16)
+			{
+				const uint16x8_t Depth0 = vld1q_u16(DepthMm + i);
+				const uint16x8_t Depth1 = vld1q_u16(DepthMm + i + 8);
+				
+				const uint16x8_t Fg0 = vandq_u16(vcgeq_u16(Depth0, FgMinDepth), vcleq_u16(Depth0, vld1q_u16(FgMaxDepthMm + i)));
+				const uint16x8_t Fg1 = vandq_u16(vcgeq_u16(Depth1, FgMinDepth), vcleq_u16(Depth1, vld1q_u16(FgMaxDepthMm + i + 8)));
+				
+				vst1q_u8(OutForeground + i, vcombine_u8(vmovn_u16(Fg0), vmovn_u16(Fg1)));
+			}
+			
+			SubtractBackgroundScalar(DepthMm, FgMaxDepthMm, OutForeground, i, End, FgMinDepthMm);
+		}
+#endif
+
+		struct FSubtractBackgroundImpl
+		{
+			FSubtractBackgroundFn Fn;
+			const TCHAR* Name;
+		};
+
+		const FSubtractBackgroundImpl& GetSubtractBackgroundImpl()
+		{
+			static const FSubtractBackgroundImpl Impl = []() -> FSubtractBackgroundImpl
+			{
+#if II_VISION_WITH_SSE2
+				if (HasAvx2())
+				{
+					return { &SubtractBackgroundAvx2, TEXT("AVX2") };
+				}
+				
+				// SSE2 is part of the x64 baseline
+				return { &SubtractBackgroundSse2, TEXT("SSE2") };
+#elif II_VISION_WITH_NEON
+				return { &SubtractBackgroundNeon, TEXT("NEON") };
+#else
+				return { &SubtractBackgroundScalar, TEXT("Scalar") };
+#endif
+			}();
+			
+			return Impl;
+		}
+	}
+
+	uint16 GetForegroundMinDepth(const FSubtractBackgroundParams& Params)
+	{
+		// 0 is what the camera gives us when it has no reading, never count it as foreground
+		return FMath::Max<uint16>(Params.MinDepthMm, 1);
+	}
+
+	void ComputeForegroundMaxDepth(
+		const uint16* BgDepthMm,
+		const bool* BgValid,
+		uint16* OutFgMaxDepthMm,
+		const int32 Count,
+		const FSubtractBackgroundParams& Params)
+	{
+		for (int32 i = 0; i < Count; ++i)
+		{
+			// In front by strictly more than the delta: Depth < Bg - Delta <=> Depth <= Bg - Delta - 1.
+			// 0 never passes, since the min depth is at least 1.
+			const int32 InFrontMaxDepth = BgDepthMm[i] - Params.DepthDeltaMm - 1;
+			const int32 FgMaxDepth = BgValid[i] ? FMath::Min<int32>(InFrontMaxDepth, Params.MaxDepthMm) : Params.MaxDepthMm;
+			OutFgMaxDepthMm[i] = static_cast<uint16>(FMath::Max(FgMaxDepth, 0));
+		}
+	}
+
+	void SubtractBackground(
+		const uint16* DepthMm,
+		const uint16* FgMaxDepthMm,
+		uint8* OutForeground,
+		const int32 Count,
+		const uint16 FgMinDepthMm)
+	{
+		GetSubtractBackgroundImpl().Fn(DepthMm, FgMaxDepthMm, OutForeground, 0, Count, FgMinDepthMm);
+	}
+
+	const TCHAR* GetSubtractBackgroundImplName()
+	{
+		return GetSubtractBackgroundImpl().Name;
+	}
+
+	void PackMaskRow(const uint8* Mask, uint64* OutBits, const int32 Width)
+	{
+		const int32 NumWords = GetNumMaskWords(Width);
+		
+		for (int32 WordIdx = 0; WordIdx < NumWords; ++WordIdx)
+		{
+			const int32 Begin = WordIdx * 64;
+			const int32 End = FMath::Min(Begin + 64, Width);
+			uint64 Word = 0;
+			int32 x = Begin;
+			
+			// 8 pixels at a time: gather the top bit of each byte into the top byte of the product
+			for (; x + 8 <= End; x += 8)
+			{
+				uint64 Bytes;
+				FMemory::Memcpy(&Bytes, Mask + x, sizeof(Bytes));
+				const uint64 Bits = ((Bytes & 0x8080808080808080ull) * 0x0002040810204081ull) >> 56;
+				Word |= Bits << (x - Begin);
+			}
+			
+			for (; x < End; ++x)
+			{
+				Word |= static_cast<uint64>(Mask[x] != 0) << (x - Begin);
+			}
+			
+			OutBits[WordIdx] = Word;
+		}
+	}
+
+	void UnpackMaskRow(const uint64* Bits, uint8* OutMask, const int32 Width)
+	{
+		// Byte -> 8 bytes of 0/0xFF
+		static const TStaticArray<uint64, 256> ExpandTable = []()
+		{
+			TStaticArray<uint64, 256> Table;
+			
+			for (uint32 Byte = 0; Byte < 256; ++Byte)
+			{
+				uint64 Expanded = 0;
+				
+				for (int32 Bit = 0; Bit < 8; ++Bit)
+				{
+					if (Byte & (1u << Bit))
+					{
+						Expanded |= 0xFFull << (Bit * 8);
+					}
+				}
+				
+				Table[Byte] = Expanded;
+			}
+			
+			return Table;
+		}();
+		
+		int32 x = 0;
+		
+		for (; x + 8 <= Width; x += 8)
+		{
+			const uint64 Expanded = ExpandTable[(Bits[x / 64] >> (x % 64)) & 0xFF];
+			FMemory::Memcpy(OutMask + x, &Expanded, sizeof(Expanded));
+		}
+		
+		for (; x < Width; ++x)
+		{
+			OutMask[x] = (Bits[x / 64] >> (x % 64)) & 1 ? TNumericLimits<uint8>::Max() : 0;
+		}
+	}
+
+	namespace
+	{
+		// A bit-sliced number per pixel, one word per bit of the number
+		struct FBitSlice2
+		{
+			uint64 B0;
+			uint64 B1;
+		};
+
+		// Per-pixel sum of 3 vertically adjacent pixels (0-3)
+		FORCEINLINE FBitSlice2 VerticalSum(const uint64 A, const uint64 B, const uint64 C)
+		{
+			return { A ^ B ^ C, (A & B) | (C & (A ^ B)) };
+		}
+
+		// Per-pixel (Left + Center + Right >= 5), where each is a vertical sum (0-3)
+		FORCEINLINE uint64 HorizontalMajority(const FBitSlice2& L, const FBitSlice2& C, const FBitSlice2& R)
+		{
+			// Ones column: T0 (weight 1), T1 (weight 2)
+			const uint64 T0 = L.B0 ^ C.B0 ^ R.B0;
+			const uint64 T1 = (L.B0 & C.B0) | (R.B0 & (L.B0 ^ C.B0));
+			
+			// Twos column: U0 (weight 2), U1 (weight 4)
+			const uint64 U0 = L.B1 ^ C.B1 ^ R.B1;
+			const uint64 U1 = (L.B1 & C.B1) | (R.B1 & (L.B1 ^ C.B1));
+			
+			// T1 + U0: W0 (weight 2), W1 (weight 4)
+			const uint64 W0 = T1 ^ U0;
+			const uint64 W1 = T1 & U0;
+			
+			// W1 + U1: K0 (weight 4), K1 (weight 8)
+			const uint64 K0 = W1 ^ U1;
+			const uint64 K1 = W1 & U1;
+			
+			// Sum = T0 + 2 * W0 + 4 * K0 + 8 * K1 >= 5
+			return K1 | (K0 & (W0 | T0));
+		}
+
+		// Combines the vertical sums of 3 consecutive words into the majority of the middle word
+		FORCEINLINE uint64 MajorityWord(const FBitSlice2& Prev, const FBitSlice2& Cur, const FBitSlice2& Next)
+		{
+			// Pixel x - 1 lands on bit x, carrying in the top bit of the previous word
+			const FBitSlice2 Left{ (Cur.B0 << 1) | (Prev.B0 >> 63), (Cur.B1 << 1) | (Prev.B1 >> 63) };
+			
+			// Pixel x + 1 lands on bit x, carrying in the bottom bit of the next word
+			const FBitSlice2 Right{ (Cur.B0 >> 1) | (Next.B0 << 63), (Cur.B1 >> 1) | (Next.B1 << 63) };
+			
+			return HorizontalMajority(Left, Cur, Right);
+		}
+	}
+
+	void MajorityFilterRow(
+		const uint64* Above,
+		const uint64* Row,
+		const uint64* Below,
+		uint64* OutRow,
+		const int32 Width)
+	{
+		const int32 NumWords = GetNumMaskWords(Width);
+		
+		// Bits past the right edge are set by their neighbours, so clear them at the end
+		const int32 NumBitsInLastWord = Width - (NumWords - 1) * 64;
+		const uint64 LastWordMask = NumBitsInLastWord >= 64 ? ~0ull : (1ull << NumBitsInLastWord) - 1;
+		
+		FBitSlice2 Prev{ 0, 0 };
+		FBitSlice2 Cur = VerticalSum(Above[0], Row[0], Below[0]);
+		
+		for (int32 WordIdx = 0; WordIdx < NumWords - 1; ++WordIdx)
+		{
+			const FBitSlice2 Next = VerticalSum(Above[WordIdx + 1], Row[WordIdx + 1], Below[WordIdx + 1]);
+			OutRow[WordIdx] = MajorityWord(Prev, Cur, Next);
+			Prev = Cur;
+			Cur = Next;
+		}
+		
+		// Right edge
+		OutRow[NumWords - 1] = MajorityWord(Prev, Cur, { 0, 0 }) & LastWordMask;
+	}
+
+	uint16 MedianDepth(uint16* Samples, const int32 Count)
+	{
+		check(Count > 0);
+		
+		constexpr int32 MaxHistogramBins = 256;
+		const int32 MedianIdx = Count / 2;
+		
+		uint16 MinDepth = Samples[0];
+		uint16 MaxDepth = Samples[0];
+		
+		for (int32 SampleIdx = 1; SampleIdx < Count; ++SampleIdx)
+		{
+			MinDepth = FMath::Min(MinDepth, Samples[SampleIdx]);
+			MaxDepth = FMath::Max(MaxDepth, Samples[SampleIdx]);
+		}
+		
+		if (MaxDepth - MinDepth >= MaxHistogramBins)
+		{
+			std::nth_element(Samples, Samples + MedianIdx, Samples + Count);
+			return Samples[MedianIdx];
+		}
+		
+		int32 Histogram[MaxHistogramBins];
+		FMemory::Memzero(Histogram, (MaxDepth - MinDepth + 1) * sizeof(int32));
+		
+		for (int32 SampleIdx = 0; SampleIdx < Count; ++SampleIdx)
+		{
+			++Histogram[Samples[SampleIdx] - MinDepth];
+		}
+		
+		// Walk up until we've passed MedianIdx samples
+		int32 NumBelow = 0;
+		int32 Bin = 0;
+		
+		while (NumBelow + Histogram[Bin] <= MedianIdx)
+		{
+			NumBelow += Histogram[Bin++];
+		}
+		
+		return static_cast<uint16>(MinDepth + Bin);
+	}
+
+	void UpdateBackgroundModel(
+		const uint16* DepthMm,
+		uint16* BgDepthMm,
+		uint16* BgStepMm,
+		uint16* NumSamples,
+		const uint64* ExcludeBits,
+		const int32 Count,
+		const FBackgroundModelParams& Params)
+	{
+		constexpr uint16 UpBit = 0x8000;
+		constexpr uint16 InitialStepMm = 32;
+		const uint16 MaxStepMm = FMath::Clamp<uint16>(Params.MaxStepMm, 1, UpBit - 1);
+		
+		for (int32 Idx = 0; Idx < Count; ++Idx)
+		{
+			const uint16 Depth = DepthMm[Idx];
+			
+			if (Depth < Params.MinDepthMm || Depth > Params.MaxDepthMm)
+			{
+				continue;
+			}
+			
+			if (ExcludeBits && (ExcludeBits[Idx / 64] >> (Idx % 64)) & 1)
+			{
+				continue;
+			}
+			
+			if (NumSamples[Idx] == 0)
+			{
+				BgDepthMm[Idx] = Depth;
+				BgStepMm[Idx] = FMath::Min(InitialStepMm, MaxStepMm);
+				NumSamples[Idx] = 1;
+				continue;
+			}
+			
+			// Saturate, we only care whether there have been enough
+			NumSamples[Idx] += NumSamples[Idx] < TNumericLimits<uint16>::Max();
+			
+			const uint16 Bg = BgDepthMm[Idx];
+			
+			if (Depth == Bg)
+			{
+				continue;
+			}
+			
+			const bool bUp = Depth > Bg;
+			const bool bLastUp = (BgStepMm[Idx] & UpBit) != 0;
+			const uint16 LastStep = BgStepMm[Idx] & ~UpBit;
+			
+			// Grow slower than we shrink, so that when samples land on either side at random the step shrinks overall.
+			// Both ways are capped, as calibration may have left the step at a much larger max than adapting runs with.
+			const uint16 Step = bUp == bLastUp 
+				? FMath::Min<uint16>(LastStep + LastStep / 4 + 1, MaxStepMm) 
+				: FMath::Min<uint16>(FMath::Max<uint16>(LastStep / 2, 1), MaxStepMm);
+			
+			const uint16 Move = FMath::Min<uint16>(Step, bUp ? Depth - Bg : Bg - Depth);
+			BgDepthMm[Idx] = bUp ? Bg + Move : Bg - Move;
+			BgStepMm[Idx] = Step | (bUp ? UpBit : 0);
+		}
+	}
+
+	void BackProjectRow(
+		const uint16* DepthMm,
+		const float* RayX,
+		const float RayY,
+		float* OutX,
+		float* OutY,
+		float* OutZ,
+		const int32 Count)
+	{
+		for (int32 Idx = 0; Idx < Count; ++Idx)
+		{
+			const float Z = DepthMm[Idx] * 0.001f;
+			OutX[Idx] = RayX[Idx] * Z;
+			OutY[Idx] = RayY * Z;
+			OutZ[Idx] = Z;
+		}
+	}
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Low-level per-pixel kernels used by the blob tracker.
+ * These work on raw spans so that they can be run over a whole frame, a band of rows, or a single row.
+ */
+namespace II::Vision::Kernels
+{
+	struct FSubtractBackgroundParams
+	{
+		uint16 MinDepthMm = 0;
+		uint16 MaxDepthMm = 0;
+		
+		// A pixel is foreground if it is closer than the background by strictly more than this
+		uint16 DepthDeltaMm = 0;
+	};
+
+	/**
+	 * The background test boils down to a per-pixel depth range: a pixel is foreground if it is in range and in front
+	 * of the background (or in range and has no valid background), which is the same as
+	 * GetForegroundMinDepth <= Depth <= FgMaxDepthMm. The min depth is the same for every pixel, so SubtractBackground
+	 * only has to stream the frame and one precomputed array, rather than the background and its valid mask.
+	 */
+	uint16 GetForegroundMinDepth(const FSubtractBackgroundParams& Params);
+
+	/**
+	 * Precomputes the per-pixel max foreground depth. Only needs redoing when the background or params change.
+	 */
+	void ComputeForegroundMaxDepth(
+		const uint16* BgDepthMm,
+		const bool* BgValid,
+		uint16* OutFgMaxDepthMm,
+		int32 Count,
+		const FSubtractBackgroundParams& Params);
+
+	/**
+	 * Writes 0xFF to OutForeground for every pixel with FgMinDepthMm <= depth <= FgMaxDepthMm, and 0 otherwise.
+	 * Picks the widest SIMD implementation the CPU supports the first time it's called.
+	 */
+	void SubtractBackground(
+		const uint16* DepthMm,
+		const uint16* FgMaxDepthMm,
+		uint8* OutForeground,
+		int32 Count,
+		uint16 FgMinDepthMm);
+
+	/**
+	 * The name of the SubtractBackground implementation picked for this CPU, for logging.
+	 */
+	const TCHAR* GetSubtractBackgroundImplName();
+
+	/**
+	 * The number of 64-bit words needed to hold one row of a 1-bit-per-pixel mask.
+	 * Pixel X of a row lives in bit (X % 64) of word (X / 64), and bits past the width are always 0.
+	 */
+	FORCEINLINE int32 GetNumMaskWords(const int32 Width)
+	{
+		return (Width + 63) / 64;
+	}
+
+	/**
+	 * Packs a row of 0/0xFF bytes into bits.
+	 */
+	void PackMaskRow(const uint8* Mask, uint64* OutBits, int32 Width);
+
+	/**
+	 * Expands a row of bits back into 0/0xFF bytes.
+	 */
+	void UnpackMaskRow(const uint64* Bits, uint8* OutMask, int32 Width);
+
+	/**
+	 * 3x3 majority vote on packed rows: a pixel is set if at least 5 of the 9 pixels around it are set.
+	 * Pixels outside the image count as unset, so pass an all-zero row for Above/Below at the top/bottom.
+	 * The 9-pixel count is done bit-sliced on whole words: a vertical 3-row sum, then a horizontal sum of
+	 * that with its left and right neighbours.
+	 */
+	void MajorityFilterRow(const uint64* Above, const uint64* Row, const uint64* Below, uint64* OutRow, int32 Width);
+
+	/**
+	 * The lower median of Count > 0 depth samples, i.e. the element at Count / 2 if they were sorted. May reorder them.
+	 * Depth samples of a static background are usually within a few mm of each other, so this counts them into a small
+	 * histogram over their range when it can, and only falls back to a partial sort when they are spread out.
+	 */
+	uint16 MedianDepth(uint16* Samples, int32 Count);
+
+	struct FBackgroundModelParams
+	{
+		// Samples outside this range are ignored
+		uint16 MinDepthMm = 0;
+		uint16 MaxDepthMm = 0;
+		
+		// How far the estimate may move on one sample. Caps how fast the model can adapt.
+		uint16 MaxStepMm = 0;
+	};
+
+	/**
+	 * Folds one frame's worth of depth samples into a streaming, per-pixel approximate median of the background.
+	 * Each pixel keeps its estimate, a step size and a sample count, and nothing else, so memory doesn't grow with the
+	 * number of frames. Every in-range sample moves the estimate towards itself by at most the step size. The step
+	 * grows while samples keep landing on the same side and halves when they switch sides, so it closes in on the
+	 * median fast and then settles down to jittering around it by a few mm.
+	 * BgStepMm holds the step in the low 15 bits and the direction of the last move in the top bit.
+	 * A pixel with NumSamples == 0 is uninitialised, and takes its first sample as is.
+	 * ExcludeBits, if not null, is a packed mask of pixels to leave alone, laid out like a packed row.
+	 */
+	void UpdateBackgroundModel(
+		const uint16* DepthMm,
+		uint16* BgDepthMm,
+		uint16* BgStepMm,
+		uint16* NumSamples,
+		const uint64* ExcludeBits,
+		int32 Count,
+		const FBackgroundModelParams& Params);
+
+	/**
+	 * Back-projects a row of depth pixels into camera space, in meters, given that row's ray coefficients:
+	 * RayX[x] = (x - Cx) / Fx for each column and RayY = (y - Cy) / Fy for the row. That leaves one multiply per
+	 * coordinate instead of a divide, and no dependencies between pixels, so it vectorises.
+	 * Pixels with no reading come out as (0, 0, 0).
+	 */
+	void BackProjectRow(
+		const uint16* DepthMm,
+		const float* RayX,
+		float RayY,
+		float* OutX,
+		float* OutY,
+		float* OutZ,
+		int32 Count);
+}
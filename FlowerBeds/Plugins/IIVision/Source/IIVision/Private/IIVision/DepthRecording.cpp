@@ -0,0 +1,227 @@
+#include "IIVision/DepthRecording.h"
+
+#include "IIVision/IIVisionModule.h"
+#include "IIVision/RvlCodec.h"
+
+#include "HAL/FileManager.h"
+#include "Serialization/Archive.h"
+
+namespace II::Vision
+{
+	namespace
+	{
+		constexpr uint32 RecordingMagic = 0x52444949; // "IIDR"
+		constexpr uint32 RecordingVersion = 1;
+
+		// Stay well clear of anything a real camera does, so a corrupt header can't make us allocate gigabytes
+		constexpr int32 MaxFrameDimension = 8192;
+
+		struct FFrameHeader
+		{
+			uint64 TimestampUs = 0;
+			int32 Width = 0;
+			int32 Height = 0;
+			FCameraIntrinsics Intrinsics{};
+			int32 NumCompressedBytes = 0;
+			
+			friend FArchive& operator<<(FArchive& Ar, FFrameHeader& Header)
+			{
+				Ar << Header.TimestampUs;
+				Ar << Header.Width;
+				Ar << Header.Height;
+				Ar << Header.Intrinsics.Fx;
+				Ar << Header.Intrinsics.Fy;
+				Ar << Header.Intrinsics.Cx;
+				Ar << Header.Intrinsics.Cy;
+				Ar << Header.NumCompressedBytes;
+				return Ar;
+			}
+		};
+	}
+
+	TUniquePtr<FDepthRecordingWriter> FDepthRecordingWriter::Create(const FString& Path)
+	{
+		TUniquePtr<FArchive> Archive(IFileManager::Get().CreateFileWriter(*Path));
+		
+		if (!Archive)
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("Couldn't open depth recording '%s' for writing"), *Path);
+			return nullptr;
+		}
+		
+		uint32 Magic = RecordingMagic;
+		uint32 Version = RecordingVersion;
+		*Archive << Magic;
+		*Archive << Version;
+		
+		return TUniquePtr<FDepthRecordingWriter>(new FDepthRecordingWriter(MoveTemp(Archive), Path));
+	}
+
+	FDepthRecordingWriter::FDepthRecordingWriter(TUniquePtr<FArchive> InArchive, const FString& InPath)
+		: Archive(MoveTemp(InArchive))
+		, Path(InPath)
+	{
+	}
+
+	FDepthRecordingWriter::~FDepthRecordingWriter()
+	{
+		if (LastWriteTask.IsValid())
+		{
+			LastWriteTask.Wait();
+		}
+		
+		Archive->Close();
+		
+		UE_LOG(LogIIVision, Display, TEXT("Wrote %d frames to depth recording '%s'"), NumFramesWritten, *Path);
+	}
+
+	void FDepthRecordingWriter::WriteFrame(const FFramePacket& Frame)
+	{
+		const int32 NumPixels = Frame.Width * Frame.Height;
+		
+		if (Frame.DepthMm.Num() != NumPixels)
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("Not recording frame, data size mismatch. Expected %d pixels, got %d"), NumPixels, Frame.DepthMm.Num());
+			return;
+		}
+		
+		// The disk isn't keeping up. Catch up rather than drop frames, so a replay still sees every one.
+		if (NumPendingFrames >= MaxPendingFrames)
+		{
+			LastWriteTask.Wait();
+		}
+		
+		++NumPendingFrames;
+		
+		// The copy of the packet holds on to its DataOwner, so the depths stay put until they're written
+		auto Write = [this, Frame]
+		{
+			WriteFrameNow(Frame);
+			--NumPendingFrames;
+		};
+		
+		LastWriteTask = LastWriteTask.IsValid()
+			? UE::Tasks::Launch(
+				UE_SOURCE_LOCATION, 
+				MoveTemp(Write), 
+				UE::Tasks::Prerequisites(LastWriteTask), 
+				UE::Tasks::ETaskPriority::BackgroundNormal)
+			: UE::Tasks::Launch(UE_SOURCE_LOCATION, MoveTemp(Write), UE::Tasks::ETaskPriority::BackgroundNormal);
+	}
+
+	void FDepthRecordingWriter::WriteFrameNow(const FFramePacket& Frame)
+	{
+		const int32 NumPixels = Frame.Width * Frame.Height;
+		CompressedBuffer.SetNumUninitialized(Rvl::GetMaxCompressedSize(NumPixels));
+		
+		FFrameHeader Header;
+		Header.TimestampUs = Frame.TimestampUs;
+		Header.Width = Frame.Width;
+		Header.Height = Frame.Height;
+		Header.Intrinsics = Frame.Intrinsics;
+		Header.NumCompressedBytes = Rvl::Compress(Frame.DepthMm.GetData(), NumPixels, CompressedBuffer.GetData());
+		
+		*Archive << Header;
+		Archive->Serialize(CompressedBuffer.GetData(), Header.NumCompressedBytes);
+		++NumFramesWritten;
+	}
+
+	TUniquePtr<FDepthRecordingReader> FDepthRecordingReader::Open(const FString& Path)
+	{
+		TUniquePtr<FArchive> Archive(IFileManager::Get().CreateFileReader(*Path));
+		
+		if (!Archive)
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("Couldn't open depth recording '%s'"), *Path);
+			return nullptr;
+		}
+		
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		*Archive << Magic;
+		*Archive << Version;
+		
+		if (Archive->IsError() || Magic != RecordingMagic || Version != RecordingVersion)
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("'%s' isn't a depth recording we can read"), *Path);
+			return nullptr;
+		}
+		
+		return TUniquePtr<FDepthRecordingReader>(new FDepthRecordingReader(MoveTemp(Archive)));
+	}
+
+	FDepthRecordingReader::FDepthRecordingReader(TUniquePtr<FArchive> InArchive)
+		: Archive(MoveTemp(InArchive))
+	{
+		FirstFrameOffset = Archive->Tell();
+	}
+
+	FDepthRecordingReader::~FDepthRecordingReader()
+	{
+		Archive->Close();
+	}
+
+	bool FDepthRecordingReader::ReadFrame(FFramePacket& OutFrame)
+	{
+		// If that was the last reference to the previous frame's buffer, we can reuse it
+		OutFrame.DepthMm = {};
+		OutFrame.DataOwner.Reset();
+		
+		if (Archive->AtEnd())
+		{
+			return false;
+		}
+		
+		FFrameHeader Header;
+		*Archive << Header;
+		
+		const bool bIsSane =
+			Header.Width > 0 && Header.Width <= MaxFrameDimension
+			&& Header.Height > 0 && Header.Height <= MaxFrameDimension
+			&& Header.NumCompressedBytes >= 0
+			&& Header.NumCompressedBytes <= Rvl::GetMaxCompressedSize(Header.Width * Header.Height);
+		
+		if (Archive->IsError() || !bIsSane)
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("Corrupt frame header in depth recording at offset %lld"), Archive->Tell());
+			return false;
+		}
+		
+		CompressedBuffer.SetNumUninitialized(Header.NumCompressedBytes);
+		Archive->Serialize(CompressedBuffer.GetData(), Header.NumCompressedBytes);
+		
+		if (Archive->IsError())
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("Depth recording ends partway through a frame"));
+			return false;
+		}
+		
+		// Reuse the last frame's buffer, unless it's still in use
+		if (!DepthBuffer || !DepthBuffer.IsUnique())
+		{
+			DepthBuffer = MakeShared<TArray<uint16>>();
+		}
+		
+		const int32 NumPixels = Header.Width * Header.Height;
+		DepthBuffer->SetNumUninitialized(NumPixels);
+		
+		if (!Rvl::Decompress(CompressedBuffer.GetData(), Header.NumCompressedBytes, DepthBuffer->GetData(), NumPixels))
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("Corrupt frame data in depth recording at offset %lld"), Archive->Tell());
+			return false;
+		}
+		
+		OutFrame.Width = Header.Width;
+		OutFrame.Height = Header.Height;
+		OutFrame.TimestampUs = Header.TimestampUs;
+		OutFrame.Intrinsics = Header.Intrinsics;
+		OutFrame.DepthMm = *DepthBuffer;
+		OutFrame.DataOwner = DepthBuffer;
+		return true;
+	}
+
+	void FDepthRecordingReader::Rewind()
+	{
+		Archive->Seek(FirstFrameOffset);
+	}
+}
@@ -0,0 +1,127 @@
+#include "IIVision/FrameSynchronizer.h"
+
+#include "IIVision/IIVisionModule.h"
+
+namespace II::Vision
+{
+	void FFrameSynchronizer::Configure(const FConfig& InConfig)
+	{
+		Config = InConfig;
+		Config.MaxFramesPerSource = FMath::Max(Config.MaxFramesPerSource, 1);
+	}
+	
+	void FFrameSynchronizer::PushFrame(const int32 SourceIdx, const FFramePacket& Frame)
+	{
+		if (SourceIdx < 0)
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("FFrameSynchronizer: Invalid source index %d"), SourceIdx);
+			return;
+		}
+		
+		if (SourceIdx >= Sources.Num())
+		{
+			Sources.SetNum(SourceIdx + 1);
+		}
+		
+		FSource& Source = Sources[SourceIdx];
+		
+		// Equal is fine, the later one wins when we pick
+		if (Frame.SystemTimestampUs < Source.LatestTimestampUs)
+		{
+			return;
+		}
+		
+		if (Source.Frames.Num() >= Config.MaxFramesPerSource)
+		{
+			Source.Frames.RemoveAt(0, 1, EAllowShrinking::No);
+		}
+		
+		Source.Frames.Add(Frame);
+		Source.LatestTimestampUs = Frame.SystemTimestampUs;
+	}
+	
+	bool FFrameSynchronizer::TryPopBundle(FBundle& OutBundle)
+	{
+		uint64 NewestTimestampUs = 0;
+		
+		for (const FSource& Source : Sources)
+		{
+			NewestTimestampUs = FMath::Max(NewestTimestampUs, Source.LatestTimestampUs);
+		}
+		
+		if (!NewestTimestampUs)
+		{
+			return false;
+		}
+		
+		// The newest moment every camera we're still waiting for has covered. Cameras that have never pushed
+		// anything, or are too far behind, aren't waited for.
+		uint64 BundleTimestampUs = NewestTimestampUs;
+		
+		for (const FSource& Source : Sources)
+		{
+			if (Source.LatestTimestampUs && Source.LatestTimestampUs + Config.MaxWaitUs >= NewestTimestampUs)
+			{
+				BundleTimestampUs = FMath::Min(BundleTimestampUs, Source.LatestTimestampUs);
+			}
+		}
+		
+		if (BundleTimestampUs <= LastBundleTimestampUs)
+		{
+			return false;
+		}
+		
+		// Each camera's frame closest to the moment, if it's close enough. It and everything older are done with.
+		OutBundle.SystemTimestampUs = BundleTimestampUs;
+		OutBundle.Frames.Reset();
+		OutBundle.Frames.SetNum(Sources.Num());
+		bool bHasFrame = false;
+		
+		for (int32 SourceIdx = 0; SourceIdx < Sources.Num(); ++SourceIdx)
+		{
+			TArray<FFramePacket>& Frames = Sources[SourceIdx].Frames;
+			int32 ClosestIdx = INDEX_NONE;
+			uint64 ClosestDistUs = Config.ToleranceUs;
+			
+			for (int32 FrameIdx = 0; FrameIdx < Frames.Num(); ++FrameIdx)
+			{
+				const uint64 FrameTimestampUs = Frames[FrameIdx].SystemTimestampUs;
+				const uint64 DistUs = FrameTimestampUs > BundleTimestampUs
+					? FrameTimestampUs - BundleTimestampUs
+					: BundleTimestampUs - FrameTimestampUs;
+				
+				if (DistUs <= ClosestDistUs)
+				{
+					ClosestIdx = FrameIdx;
+					ClosestDistUs = DistUs;
+				}
+			}
+			
+			int32 NumDone = 0;
+			
+			if (ClosestIdx != INDEX_NONE)
+			{
+				OutBundle.Frames[SourceIdx] = MoveTemp(Frames[ClosestIdx]);
+				NumDone = ClosestIdx + 1;
+				bHasFrame = true;
+			}
+			
+			// Too old to go with this bundle or any after it
+			while (NumDone < Frames.Num() && Frames[NumDone].SystemTimestampUs + Config.ToleranceUs < BundleTimestampUs)
+			{
+				++NumDone;
+			}
+			
+			Frames.RemoveAt(0, NumDone, EAllowShrinking::No);
+		}
+		
+		LastBundleTimestampUs = BundleTimestampUs;
+		return bHasFrame;
+	}
+	
+	void FFrameSynchronizer::Reset()
+	{
+		Sources.Reset();
+		LastBundleTimestampUs = 0;
+	}
+}
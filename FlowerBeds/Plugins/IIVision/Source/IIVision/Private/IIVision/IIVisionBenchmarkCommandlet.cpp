@@ -0,0 +1,621 @@
+#include "IIVision/IIVisionBenchmarkCommandlet.h"
+
+#include "IIVision/BlobTracker.h"
+#include "IIVision/DepthRecording.h"
+#include "IIVision/IIVisionModule.h"
+
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	using namespace II::Vision;
+
+	constexpr int32 NumCalibrationFrames = 60;
+
+	// Detected but not measured, so scratch buffers are at their steady state size before we start counting
+	constexpr int32 NumWarmUpFrames = 10;
+
+	/**
+	 * Counts allocations made through GMalloc, passing everything through to the real allocator.
+	 * Counts every thread, so allocations made by the task graph on Detect's behalf show up too.
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInner)
+			: Inner(InInner)
+		{
+		}
+		
+		uint64 GetNumAllocations() const
+		{
+			return NumAllocations.load(std::memory_order_relaxed);
+		}
+		
+		virtual void* Malloc(const SIZE_T Size, const uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return Inner->Malloc(Size, Alignment);
+		}
+		
+		virtual void* Realloc(void* Ptr, const SIZE_T NewSize, const uint32 Alignment) override
+		{
+			if (NewSize)
+			{
+				NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			}
+			
+			return Inner->Realloc(Ptr, NewSize, Alignment);
+		}
+		
+		virtual void Free(void* Ptr) override
+		{
+			Inner->Free(Ptr);
+		}
+		
+		virtual bool GetAllocationSize(void* Ptr, SIZE_T& OutSize) override
+		{
+			return Inner->GetAllocationSize(Ptr, OutSize);
+		}
+		
+		virtual SIZE_T QuantizeSize(const SIZE_T Count, const uint32 Alignment) override
+		{
+			return Inner->QuantizeSize(Count, Alignment);
+		}
+		
+		virtual void Trim(const bool bTrimThreadCaches) override
+		{
+			Inner->Trim(bTrimThreadCaches);
+		}
+		
+		virtual void SetupTLSCachesOnCurrentThread() override
+		{
+			Inner->SetupTLSCachesOnCurrentThread();
+		}
+		
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+		{
+			Inner->ClearAndDisableTLSCachesOnCurrentThread();
+		}
+		
+		virtual bool IsInternallyThreadSafe() const override
+		{
+			return Inner->IsInternallyThreadSafe();
+		}
+		
+		virtual const TCHAR* GetDescriptiveName() override
+		{
+			return TEXT("IIVisionBenchmarkCountingMalloc");
+		}
+	
+	private:
+		FMalloc* Inner = nullptr;
+		std::atomic<uint64> NumAllocations = 0;
+	};
+
+	/**
+	 * Installs an FCountingMalloc as GMalloc, once, for the rest of the process. The task graph's threads are already
+	 * running by the time a commandlet gets to run, and any of them may be partway into a call through GMalloc, so it's
+	 * heap allocated and never uninstalled or freed. It only adds an atomic increment to each allocation.
+	 */
+	const FCountingMalloc& InstallCountingMalloc()
+	{
+		static const FCountingMalloc* Counter = []
+		{
+			// FMalloc news from the system allocator, so this doesn't go through the GMalloc it's about to replace
+			FCountingMalloc* NewCounter = new FCountingMalloc(GMalloc);
+			GMalloc = NewCounter;
+			return NewCounter;
+		}();
+		
+		return *Counter;
+	}
+
+	/**
+	 * A room seen from the side: a floor, a back wall, and people walking around in it as upright cylinders.
+	 * Camera space, in meters: X right, Y down, Z forward.
+	 */
+	class FSyntheticScene
+	{
+	public:
+		FSyntheticScene(const int32 InWidth, const int32 InHeight, const int32 NumPeople, const int32 Seed)
+			: Width(InWidth)
+			, Height(InHeight)
+			, Random(Seed)
+		{
+			Intrinsics = { Width * 0.8f, Width * 0.8f, Width * 0.5f, Height * 0.5f };
+			
+			for (int32 PersonIdx = 0; PersonIdx < NumPeople; ++PersonIdx)
+			{
+				const float Heading = Random.FRandRange(0.0f, UE_TWO_PI);
+				const float Speed = Random.FRandRange(0.5f, 1.5f);
+				
+				People.Add({
+					FVector2D(Random.FRandRange(MinX, MaxX), Random.FRandRange(MinZ, MaxZ)),
+					FVector2D(FMath::Cos(Heading), FMath::Sin(Heading)) * Speed
+				});
+			}
+		}
+		
+		int32 GetWidth() const { return Width; }
+		int32 GetHeight() const { return Height; }
+		const FCameraIntrinsics& GetIntrinsics() const { return Intrinsics; }
+		
+		// Walks everyone on by DeltaSeconds, bouncing off the edges of the room
+		void Step(const float DeltaSeconds)
+		{
+			for (FPerson& Person : People)
+			{
+				Person.Pos += Person.Velocity * DeltaSeconds;
+				
+				if (Person.Pos.X < MinX || Person.Pos.X > MaxX)
+				{
+					Person.Velocity.X = -Person.Velocity.X;
+				}
+				
+				if (Person.Pos.Y < MinZ || Person.Pos.Y > MaxZ)
+				{
+					Person.Velocity.Y = -Person.Velocity.Y;
+				}
+			}
+		}
+		
+		void Render(const bool bWithPeople, TArray<uint16>& OutDepthMm)
+		{
+			OutDepthMm.SetNumUninitialized(Width * Height);
+			
+			// Floor and wall
+			for (int32 y = 0; y < Height; ++y)
+			{
+				const float RayY = (y - Intrinsics.Cy) / Intrinsics.Fy;
+				const float FloorZ = RayY > 0.0f ? CameraHeight / RayY : WallZ;
+				const uint16 RowDepthMm = static_cast<uint16>(FMath::Min(FMath::Min(FloorZ, WallZ) * 1000.0f, 65535.0f));
+				
+				for (int32 x = 0; x < Width; ++x)
+				{
+					OutDepthMm[y * Width + x] = RowDepthMm;
+				}
+			}
+			
+			if (bWithPeople)
+			{
+				for (const FPerson& Person : People)
+				{
+					RenderPerson(Person, OutDepthMm);
+				}
+			}
+			
+			// Sensor noise, and the odd pixel with no reading
+			for (uint16& DepthMm : OutDepthMm)
+			{
+				if (Random.FRand() < 0.01f)
+				{
+					DepthMm = 0;
+				}
+				else
+				{
+					DepthMm = static_cast<uint16>(FMath::Clamp(DepthMm + Random.RandRange(-DepthMm / 200, DepthMm / 200), 1, 65535));
+				}
+			}
+		}
+	
+	private:
+		struct FPerson
+		{
+			// X and Z
+			FVector2D Pos;
+			FVector2D Velocity;
+		};
+		
+		static constexpr float CameraHeight = 1.5f;
+		static constexpr float WallZ = 5.5f;
+		static constexpr float PersonRadius = 0.25f;
+		static constexpr float PersonHeight = 1.7f;
+		static constexpr float MinX = -2.0f;
+		static constexpr float MaxX = 2.0f;
+		static constexpr float MinZ = 1.5f;
+		static constexpr float MaxZ = 4.5f;
+		
+		int32 Width = 0;
+		int32 Height = 0;
+		FCameraIntrinsics Intrinsics{};
+		FRandomStream Random;
+		TArray<FPerson> People;
+		
+		void RenderPerson(const FPerson& Person, TArray<uint16>& OutDepthMm) const
+		{
+			const float Px = Person.Pos.X;
+			const float Pz = Person.Pos.Y;
+			
+			// Only the columns the cylinder can cover
+			const float NearZ = FMath::Max(Pz - PersonRadius, 0.1f);
+			const float MinRayX = FMath::Min((Px - PersonRadius) / NearZ, (Px - PersonRadius) / (Pz + PersonRadius));
+			const float MaxRayX = FMath::Max((Px + PersonRadius) / NearZ, (Px + PersonRadius) / (Pz + PersonRadius));
+			const int32 MinCol = FMath::Max(FMath::FloorToInt32(Intrinsics.Cx + MinRayX * Intrinsics.Fx), 0);
+			const int32 MaxCol = FMath::Min(FMath::CeilToInt32(Intrinsics.Cx + MaxRayX * Intrinsics.Fx), Width - 1);
+			
+			for (int32 x = MinCol; x <= MaxCol; ++x)
+			{
+				// A vertical cylinder, so where the ray hits it depends only on the column. Solve
+				// (t RayX - Px)^2 + (t - Pz)^2 = R^2 for the nearer t.
+				const float RayX = (x - Intrinsics.Cx) / Intrinsics.Fx;
+				const float A = RayX * RayX + 1.0f;
+				const float B = -2.0f * (RayX * Px + Pz);
+				const float C = Px * Px + Pz * Pz - PersonRadius * PersonRadius;
+				const float Discriminant = B * B - 4.0f * A * C;
+				
+				if (Discriminant < 0.0f)
+				{
+					continue;
+				}
+				
+				const float Z = (-B - FMath::Sqrt(Discriminant)) / (2.0f * A);
+				
+				if (Z <= 0.0f)
+				{
+					continue;
+				}
+				
+				// Feet on the floor
+				const int32 MinRow = FMath::Max(FMath::FloorToInt32(Intrinsics.Cy + Intrinsics.Fy * (CameraHeight - PersonHeight) / Z), 0);
+				const int32 MaxRow = FMath::Min(FMath::CeilToInt32(Intrinsics.Cy + Intrinsics.Fy * CameraHeight / Z), Height - 1);
+				const uint16 DepthMm = static_cast<uint16>(FMath::Min(Z * 1000.0f, 65535.0f));
+				
+				for (int32 y = MinRow; y <= MaxRow; ++y)
+				{
+					uint16& Pixel = OutDepthMm[y * Width + x];
+					Pixel = FMath::Min(Pixel, DepthMm);
+				}
+			}
+		}
+	};
+
+	struct FStage
+	{
+		const TCHAR* Name;
+		double FBlobTracker::FStageTimings::* Seconds;
+	};
+
+	const FStage Stages[] = {
+		{ TEXT("SubtractBackground"), &FBlobTracker::FStageTimings::SubtractBackground },
+		{ TEXT("MajorityFilter"), &FBlobTracker::FStageTimings::MajorityFilter },
+		{ TEXT("ExtractBlobs"), &FBlobTracker::FStageTimings::ExtractBlobs },
+		{ TEXT("FusedSweep"), &FBlobTracker::FStageTimings::FusedSweep },
+		{ TEXT("Compute3DBlobs"), &FBlobTracker::FStageTimings::Compute3DBlobs },
+		{ TEXT("Tracking"), &FBlobTracker::FStageTimings::Tracking },
+	};
+
+	struct FPipeline
+	{
+		const TCHAR* Name;
+		FBlobTracker::FDetectionConfig Config;
+	};
+
+	TArray<FPipeline> MakePipelines()
+	{
+		FBlobTracker::FDetectionConfig Serial;
+		
+		FBlobTracker::FDetectionConfig Fused;
+		Fused.bFusedPipeline = true;
+		
+		FBlobTracker::FDetectionConfig Banded;
+		Banded.NumParallelBands = FPlatformMisc::NumberOfCores();
+		
+		return { { TEXT("Serial"), Serial }, { TEXT("Fused"), Fused }, { TEXT("Banded"), Banded } };
+	}
+
+	// Hands out frames in order, calibration frames first. Returns false when it runs out.
+	using FFrameSource = TFunction<bool(FFramePacket&)>;
+
+	double GetPercentile(const TArray<double>& Sorted, const double Percentile)
+	{
+		if (Sorted.IsEmpty())
+		{
+			return 0.0;
+		}
+		
+		return Sorted[FMath::RoundToInt32(Percentile * (Sorted.Num() - 1))];
+	}
+
+	TSharedRef<FJsonObject> MakeLatencyJson(TArray<double>& Seconds)
+	{
+		Seconds.Sort();
+		
+		double Sum = 0.0;
+		
+		for (const double Value : Seconds)
+		{
+			Sum += Value;
+		}
+		
+		const TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+		Json->SetNumberField(TEXT("p50_ms"), GetPercentile(Seconds, 0.5) * 1000.0);
+		Json->SetNumberField(TEXT("p99_ms"), GetPercentile(Seconds, 0.99) * 1000.0);
+		Json->SetNumberField(TEXT("mean_ms"), Seconds.IsEmpty() ? 0.0 : Sum / Seconds.Num() * 1000.0);
+		return Json;
+	}
+
+	TSharedPtr<FJsonObject> RunScenario(
+		const FString& Name,
+		const FBlobTracker::FDetectionConfig& Config,
+		const FFrameSource& NextFrame,
+		const int32 NumFrames,
+		const FCountingMalloc& Counter)
+	{
+		FBlobTracker Tracker;
+		Tracker.ConfigureDetection(Config);
+		
+		FFramePacket Frame;
+		
+		if (!NextFrame(Frame))
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("%s: no frames"), *Name);
+			return nullptr;
+		}
+		
+		Tracker.BeginCalibration(NumCalibrationFrames, Frame.Width, Frame.Height);
+		Tracker.PushCalibrationFrame(Frame);
+		
+		while (Tracker.GetCalibrationState() != FBlobTracker::ECalibrationState::Calibrated)
+		{
+			if (!NextFrame(Frame))
+			{
+				UE_LOG(LogIIVision, Warning, TEXT("%s: ran out of frames while calibrating"), *Name);
+				return nullptr;
+			}
+			
+			Tracker.PushCalibrationFrame(Frame);
+		}
+		
+		FBlobTracker::FDetectionResult Result;
+		
+		for (int32 FrameIdx = 0; FrameIdx < NumWarmUpFrames && NextFrame(Frame); ++FrameIdx)
+		{
+			Tracker.Detect(Frame, Result);
+		}
+		
+		TArray<double> StageSeconds[UE_ARRAY_COUNT(Stages)];
+		TArray<double> TotalSeconds;
+		TArray<double> PointCloudSeconds;
+		FBlobTracker::FPointCloud PointCloud;
+		uint64 TotalAllocations = 0;
+		uint64 MaxAllocations = 0;
+		int32 TotalBlobs = 0;
+		
+		for (int32 FrameIdx = 0; FrameIdx < NumFrames && NextFrame(Frame); ++FrameIdx)
+		{
+			const uint64 StartAllocations = Counter.GetNumAllocations();
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			
+			Tracker.Detect(Frame, Result);
+			
+			TotalSeconds.Add(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles));
+			const uint64 NumAllocations = Counter.GetNumAllocations() - StartAllocations;
+			TotalAllocations += NumAllocations;
+			MaxAllocations = FMath::Max(MaxAllocations, NumAllocations);
+			TotalBlobs += Result.WorldSpaceBlobs.Num();
+			
+			for (int32 StageIdx = 0; StageIdx < UE_ARRAY_COUNT(Stages); ++StageIdx)
+			{
+				StageSeconds[StageIdx].Add(Tracker.GetLastStageTimings().*Stages[StageIdx].Seconds);
+			}
+			
+			// Not part of detection, so timed on its own and left out of the total and the allocation count
+			const uint64 PointCloudStartCycles = FPlatformTime::Cycles64();
+			Tracker.ComputePointCloud(Frame, PointCloud);
+			PointCloudSeconds.Add(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - PointCloudStartCycles));
+		}
+		
+		const int32 NumMeasured = TotalSeconds.Num();
+		
+		if (!NumMeasured)
+		{
+			UE_LOG(LogIIVision, Warning, TEXT("%s: no frames left to measure after calibration"), *Name);
+			return nullptr;
+		}
+		
+		double SumSeconds = 0.0;
+		
+		for (const double Seconds : TotalSeconds)
+		{
+			SumSeconds += Seconds;
+		}
+		
+		const TSharedRef<FJsonObject> StagesJson = MakeShared<FJsonObject>();
+		
+		for (int32 StageIdx = 0; StageIdx < UE_ARRAY_COUNT(Stages); ++StageIdx)
+		{
+			StagesJson->SetObjectField(Stages[StageIdx].Name, MakeLatencyJson(StageSeconds[StageIdx]));
+		}
+		
+		const TSharedRef<FJsonObject> TotalJson = MakeLatencyJson(TotalSeconds);
+		const double FramesPerSecond = NumMeasured / SumSeconds;
+		const double AllocationsPerFrame = static_cast<double>(TotalAllocations) / NumMeasured;
+		
+		const TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+		Json->SetStringField(TEXT("name"), Name);
+		Json->SetNumberField(TEXT("width"), Frame.Width);
+		Json->SetNumberField(TEXT("height"), Frame.Height);
+		Json->SetNumberField(TEXT("frames"), NumMeasured);
+		Json->SetNumberField(TEXT("mean_blobs"), static_cast<double>(TotalBlobs) / NumMeasured);
+		Json->SetNumberField(TEXT("frames_per_second"), FramesPerSecond);
+		Json->SetNumberField(TEXT("allocations_per_frame"), AllocationsPerFrame);
+		Json->SetNumberField(TEXT("max_allocations_per_frame"), MaxAllocations);
+		Json->SetObjectField(TEXT("total"), TotalJson);
+		Json->SetObjectField(TEXT("stages"), StagesJson);
+		Json->SetObjectField(TEXT("point_cloud"), MakeLatencyJson(PointCloudSeconds));
+		
+		UE_LOG(
+			LogIIVision,
+			Display,
+			TEXT("%-48s %8.1f fps   p50 %6.2f ms   p99 %6.2f ms   %6.1f allocs/frame"),
+			*Name,
+			FramesPerSecond,
+			TotalJson->GetNumberField(TEXT("p50_ms")),
+			TotalJson->GetNumberField(TEXT("p99_ms")),
+			AllocationsPerFrame);
+		
+		return Json;
+	}
+}
+
+UIIVisionBenchmarkCommandlet::UIIVisionBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+	
+	HelpDescription = TEXT("Benchmarks the IIVision blob tracker over synthetic crowds and depth recordings");
+	HelpParamNames.Add(TEXT("frames"));
+	HelpParamDescriptions.Add(TEXT("Frames to measure per scenario, after calibration. Defaults to 300."));
+	HelpParamNames.Add(TEXT("recording"));
+	HelpParamDescriptions.Add(TEXT("Depth recordings to run as well, separated by +"));
+	HelpParamNames.Add(TEXT("out"));
+	HelpParamDescriptions.Add(TEXT("Where to write the JSON results. Defaults to Saved/Benchmarks."));
+}
+
+int32 UIIVisionBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 NumFrames = 300;
+	FParse::Value(*Params, TEXT("frames="), NumFrames);
+	NumFrames = FMath::Max(NumFrames, 1);
+	
+	FString RecordingsParam;
+	FParse::Value(*Params, TEXT("recording="), RecordingsParam);
+	TArray<FString> Recordings;
+	RecordingsParam.ParseIntoArray(Recordings, TEXT("+"));
+	
+	FString OutPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(
+		TEXT("IIVisionBenchmark-%s.json"),
+		*FDateTime::Now().ToString());
+	FParse::Value(*Params, TEXT("out="), OutPath);
+	
+	const FCountingMalloc& Counter = InstallCountingMalloc();
+	
+	TArray<TSharedPtr<FJsonValue>> ScenariosJson;
+	
+	const auto AddResult = [&ScenariosJson](const TSharedPtr<FJsonObject>& Json, const FString& Source)
+	{
+		if (Json)
+		{
+			Json->SetStringField(TEXT("source"), Source);
+			ScenariosJson.Add(MakeShared<FJsonValueObject>(Json));
+		}
+	};
+	
+	const FIntPoint Resolutions[] = { { 320, 288 }, { 640, 576 } };
+	const int32 CrowdSizes[] = { 0, 5, 20, 50 };
+	
+	for (const FPipeline& Pipeline : MakePipelines())
+	{
+		for (const FIntPoint& Resolution : Resolutions)
+		{
+			for (const int32 NumPeople : CrowdSizes)
+			{
+				FSyntheticScene Scene(Resolution.X, Resolution.Y, NumPeople, 1);
+				TSharedPtr<TArray<uint16>> DepthBuffer;
+				int32 FrameIdx = 0;
+				
+				// Empty room while calibrating, then the crowd walks in
+				const FFrameSource NextFrame = [&Scene, &DepthBuffer, &FrameIdx](FFramePacket& OutFrame)
+				{
+					const bool bWithPeople = FrameIdx >= NumCalibrationFrames;
+					
+					if (bWithPeople)
+					{
+						Scene.Step(1.0f / 30.0f);
+					}
+					
+					// Like a recording, reuse the last frame's buffer unless the background adapt task still has it
+					OutFrame.DepthMm = {};
+					OutFrame.DataOwner.Reset();
+					
+					if (!DepthBuffer || !DepthBuffer.IsUnique())
+					{
+						DepthBuffer = MakeShared<TArray<uint16>>();
+					}
+					
+					Scene.Render(bWithPeople, *DepthBuffer);
+					
+					OutFrame.Width = Scene.GetWidth();
+					OutFrame.Height = Scene.GetHeight();
+					OutFrame.TimestampUs = FrameIdx * 33333ull;
+					OutFrame.Intrinsics = Scene.GetIntrinsics();
+					OutFrame.DepthMm = *DepthBuffer;
+					OutFrame.DataOwner = DepthBuffer;
+					++FrameIdx;
+					return true;
+				};
+				
+				const FString Name = FString::Printf(
+					TEXT("%s %dx%d, %d people"),
+					Pipeline.Name,
+					Resolution.X,
+					Resolution.Y,
+					NumPeople);
+				
+				const TSharedPtr<FJsonObject> Json = RunScenario(Name, Pipeline.Config, NextFrame, NumFrames, Counter);
+				
+				if (Json)
+				{
+					Json->SetStringField(TEXT("pipeline"), Pipeline.Name);
+					Json->SetNumberField(TEXT("people"), NumPeople);
+				}
+				
+				AddResult(Json, TEXT("synthetic"));
+			}
+		}
+		
+		for (const FString& Recording : Recordings)
+		{
+			const TUniquePtr<FDepthRecordingReader> Reader = FDepthRecordingReader::Open(Recording);
+			
+			if (!Reader)
+			{
+				continue;
+			}
+			
+			const FFrameSource NextFrame = [&Reader](FFramePacket& OutFrame)
+			{
+				return Reader->ReadFrame(OutFrame);
+			};
+			
+			const FString Name = FString::Printf(TEXT("%s %s"), Pipeline.Name, *FPaths::GetCleanFilename(Recording));
+			const TSharedPtr<FJsonObject> Json = RunScenario(Name, Pipeline.Config, NextFrame, NumFrames, Counter);
+			
+			if (Json)
+			{
+				Json->SetStringField(TEXT("pipeline"), Pipeline.Name);
+			}
+			
+			AddResult(Json, Recording);
+		}
+	}
+	
+	const TSharedRef<FJsonObject> RootJson = MakeShared<FJsonObject>();
+	RootJson->SetStringField(TEXT("date"), FDateTime::UtcNow().ToIso8601());
+	RootJson->SetStringField(TEXT("cpu"), FPlatformMisc::GetCPUBrand());
+	RootJson->SetNumberField(TEXT("cores"), FPlatformMisc::NumberOfCores());
+	RootJson->SetArrayField(TEXT("scenarios"), ScenariosJson);
+	
+	FString JsonString;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonString);
+	FJsonSerializer::Serialize(RootJson, Writer);
+	
+	if (!FFileHelper::SaveStringToFile(JsonString, *OutPath))
+	{
+		UE_LOG(LogIIVision, Error, TEXT("Couldn't write benchmark results to '%s'"), *OutPath);
+		return 1;
+	}
+	
+	UE_LOG(LogIIVision, Display, TEXT("Wrote benchmark results to '%s'"), *OutPath);
+	return 0;
+}
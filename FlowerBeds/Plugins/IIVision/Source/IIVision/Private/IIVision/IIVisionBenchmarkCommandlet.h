@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "IIVisionBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs the blob tracker headless over synthetic crowds and depth recordings, and reports how long each stage takes,
+ * frames per second and allocations per frame, as a table in the log and as JSON for tracking across builds.
+ *
+ *   UnrealEditor-Cmd <Project> -run=IIVisionBenchmark [-frames=300] [-recording=<path>[+<path>...]] [-out=<path>]
+ *
+ * Recordings are calibrated on their first frames, so should start with the scene empty, as the live system does.
+ */
+UCLASS()
+class UIIVisionBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UIIVisionBenchmarkCommandlet();
+	
+	virtual int32 Main(const FString& Params) override;
+};
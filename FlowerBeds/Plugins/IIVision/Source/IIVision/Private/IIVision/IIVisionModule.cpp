@@ -1,10 +1,15 @@
 ﻿#include "IIVision/IIVisionModule.h"
 
+#include "IIVision/DepthKernels.h"
 #include "Modules/ModuleManager.h"
 
 DEFINE_LOG_CATEGORY(LogIIVision);
 
 IMPLEMENT_MODULE(FIIVisionModule, IIVision);
 
-void FIIVisionModule::StartupModule() {}
+void FIIVisionModule::StartupModule()
+{
+	UE_LOG(LogIIVision, Log, TEXT("Background subtraction kernel: %s"), II::Vision::Kernels::GetSubtractBackgroundImplName());
+}
+
 void FIIVisionModule::ShutdownModule() {}
@@ -0,0 +1,224 @@
+#include "IIVision/MultiObjectTracker.h"
+
+namespace II::Vision
+{
+	namespace
+	{
+		// How unsure a new track is of its velocity, as a standard deviation. About walking pace.
+		constexpr float InitialSpeedStdDevMetersPerSec = 1.5f;
+
+		// Never predict further than this between frames, in case the camera clock jumps
+		constexpr double MaxPredictSeconds = 1.0;
+	}
+
+	void FMultiObjectTracker::Configure(const FTrackingConfig& InConfig)
+	{
+		Config = InConfig;
+		Config.GateRadiusMeters = FMath::Max(Config.GateRadiusMeters, UE_KINDA_SMALL_NUMBER);
+		Config.MeasurementNoiseMeters = FMath::Max(Config.MeasurementNoiseMeters, UE_KINDA_SMALL_NUMBER);
+	}
+
+	void FMultiObjectTracker::Reset()
+	{
+		Tracks.Reset();
+	}
+
+	FIntVector FMultiObjectTracker::GetCell(const FVector& PosMeters) const
+	{
+		return {
+			FMath::FloorToInt32(PosMeters.X / Config.GateRadiusMeters),
+			FMath::FloorToInt32(PosMeters.Y / Config.GateRadiusMeters),
+			FMath::FloorToInt32(PosMeters.Z / Config.GateRadiusMeters)
+		};
+	}
+
+	void FMultiObjectTracker::StartTrack(const FBlob3D& Blob, const int32 BlobIdx, const uint64 TimestampUs)
+	{
+		FTrackState& State = Tracks.AddDefaulted_GetRef();
+		State.PosVariance = FVector(FMath::Square(Config.MeasurementNoiseMeters));
+		State.VelVariance = FVector(FMath::Square(InitialSpeedStdDevMetersPerSec));
+		
+		FTrack& Track = State.Track;
+		Track.Id = NextTrackId++;
+		Track.BlobIdx = BlobIdx;
+		Track.NumHits = 1;
+		Track.Blob = Blob;
+		Track.Blob.Id = Track.Id;
+		Track.TimestampUs = TimestampUs;
+	}
+
+	void FMultiObjectTracker::PredictTrack(FTrackState& State, const uint64 TimestampUs) const
+	{
+		FTrack& Track = State.Track;
+		const double Dt = FMath::Clamp(
+			static_cast<double>(static_cast<int64>(TimestampUs - Track.TimestampUs)) * 1e-6,
+			0.0,
+			MaxPredictSeconds);
+		
+		Track.Blob.CamPosMeters += Track.CamVelocityMetersPerSec * Dt;
+		Track.TimestampUs = TimestampUs;
+		
+		// P = F P F' + Q, with F = [1 dt; 0 1] and Q from white noise acceleration
+		const double AccelVariance = FMath::Square(Config.AccelerationNoiseMetersPerSecSq);
+		const double Dt2 = Dt * Dt;
+		
+		State.PosVariance += 2.0 * Dt * State.PosVelCovariance + Dt2 * State.VelVariance;
+		State.PosVariance += FVector(AccelVariance * Dt2 * Dt2 * 0.25);
+		State.PosVelCovariance += Dt * State.VelVariance + FVector(AccelVariance * Dt2 * Dt * 0.5);
+		State.VelVariance += FVector(AccelVariance * Dt2);
+	}
+
+	void FMultiObjectTracker::CorrectTrack(FTrackState& State, const FVector& MeasuredPosMeters) const
+	{
+		FTrack& Track = State.Track;
+		
+		// We only measure position, so H = [1 0] and the gains fall out per axis
+		const FVector Innovation = MeasuredPosMeters - Track.Blob.CamPosMeters;
+		const FVector InnovationVariance = State.PosVariance + FVector(FMath::Square(Config.MeasurementNoiseMeters));
+		const FVector PosGain = State.PosVariance / InnovationVariance;
+		const FVector VelGain = State.PosVelCovariance / InnovationVariance;
+		
+		Track.Blob.CamPosMeters += PosGain * Innovation;
+		Track.CamVelocityMetersPerSec += VelGain * Innovation;
+		
+		// P = (I - K H) P
+		State.VelVariance -= VelGain * State.PosVelCovariance;
+		State.PosVelCovariance *= FVector::OneVector - PosGain;
+		State.PosVariance *= FVector::OneVector - PosGain;
+	}
+
+	void FMultiObjectTracker::Update(const TArray<FBlob3D>& Blobs, const uint64 TimestampUs, TArray<FTrack>& OutTracks)
+	{
+		const float GateRadiusSquared = FMath::Square(Config.GateRadiusMeters);
+		
+		// Move every track on to where we expect it on this frame, so the gate follows the motion
+		for (FTrackState& State : Tracks)
+		{
+			PredictTrack(State, TimestampUs);
+		}
+		
+		// Hash the blobs. With cells as big as the gate, anything within the gate of a point is in the 3x3x3 cells
+		// around it.
+		BlobGrid.Reset();
+		
+		for (int32 BlobIdx = 0; BlobIdx < Blobs.Num(); ++BlobIdx)
+		{
+			if (Blobs[BlobIdx].bValid)
+			{
+				BlobGrid.Add(GetCell(Blobs[BlobIdx].CamPosMeters), BlobIdx);
+			}
+		}
+		
+		// Gather every pair within the gate
+		Candidates.Reset();
+		
+		for (int32 TrackIdx = 0; TrackIdx < Tracks.Num(); ++TrackIdx)
+		{
+			const FVector& TrackPos = Tracks[TrackIdx].Track.Blob.CamPosMeters;
+			const FIntVector TrackCell = GetCell(TrackPos);
+			
+			for (int32 dz = -1; dz <= 1; ++dz)
+			{
+				for (int32 dy = -1; dy <= 1; ++dy)
+				{
+					for (int32 dx = -1; dx <= 1; ++dx)
+					{
+						for (auto It = BlobGrid.CreateConstKeyIterator(TrackCell + FIntVector(dx, dy, dz)); It; ++It)
+						{
+							const int32 BlobIdx = It.Value();
+							const float DistSquared = FVector::DistSquared(TrackPos, Blobs[BlobIdx].CamPosMeters);
+							
+							if (DistSquared <= GateRadiusSquared)
+							{
+								Candidates.Add({ DistSquared, TrackIdx, BlobIdx });
+							}
+						}
+					}
+				}
+			}
+		}
+		
+		// Greedy assignment, closest pairs first. Ties go to the older track, so a newcomer can't steal a blob.
+		Candidates.Sort([](const FCandidate& A, const FCandidate& B)
+		{
+			return A.DistSquared < B.DistSquared || (A.DistSquared == B.DistSquared && A.TrackIdx < B.TrackIdx);
+		});
+		
+		BlobTrackIdx.Init(INDEX_NONE, Blobs.Num());
+		TrackMatched.Init(false, Tracks.Num());
+		
+		for (const FCandidate& Candidate : Candidates)
+		{
+			if (TrackMatched[Candidate.TrackIdx] || BlobTrackIdx[Candidate.BlobIdx] != INDEX_NONE)
+			{
+				continue;
+			}
+			
+			TrackMatched[Candidate.TrackIdx] = true;
+			BlobTrackIdx[Candidate.BlobIdx] = Candidate.TrackIdx;
+		}
+		
+		// Age the unmatched tracks. They coast on their prediction.
+		for (int32 TrackIdx = 0; TrackIdx < Tracks.Num(); ++TrackIdx)
+		{
+			FTrack& Track = Tracks[TrackIdx].Track;
+			
+			if (!TrackMatched[TrackIdx])
+			{
+				Track.BlobIdx = INDEX_NONE;
+				Track.NumHits = 0;
+				++Track.NumMisses;
+			}
+		}
+		
+		// Correct the matched ones with their blob
+		for (int32 BlobIdx = 0; BlobIdx < Blobs.Num(); ++BlobIdx)
+		{
+			if (const int32 TrackIdx = BlobTrackIdx[BlobIdx]; TrackIdx != INDEX_NONE)
+			{
+				FTrackState& State = Tracks[TrackIdx];
+				FTrack& Track = State.Track;
+				const FVector PredictedPos = Track.Blob.CamPosMeters;
+				
+				Track.BlobIdx = BlobIdx;
+				Track.Blob = Blobs[BlobIdx];
+				Track.Blob.Id = Track.Id;
+				Track.Blob.CamPosMeters = PredictedPos;
+				++Track.NumHits;
+				Track.NumMisses = 0;
+				
+				CorrectTrack(State, Blobs[BlobIdx].CamPosMeters);
+			}
+		}
+		
+		// Drop tentative tracks that missed, and confirmed ones that have been gone too long. Once confirmed, a track
+		// stays confirmed, even while it coasts with NumHits back at 0. Not RemoveAllSwap, the tie-break above relies
+		// on the tracks staying oldest first.
+		Tracks.RemoveAll([this](const FTrackState& State)
+		{
+			return State.Track.NumMisses > (State.Track.bConfirmed ? Config.MaxMissesToKeep : 0);
+		});
+		
+		// Start tentative tracks for the blobs nobody claimed
+		for (int32 BlobIdx = 0; BlobIdx < Blobs.Num(); ++BlobIdx)
+		{
+			if (Blobs[BlobIdx].bValid && BlobTrackIdx[BlobIdx] == INDEX_NONE)
+			{
+				StartTrack(Blobs[BlobIdx], BlobIdx, TimestampUs);
+			}
+		}
+		
+		OutTracks.Reset();
+		
+		for (FTrackState& State : Tracks)
+		{
+			FTrack& Track = State.Track;
+			Track.bConfirmed |= Track.NumHits >= Config.MinHitsToConfirm;
+			
+			if (Track.bConfirmed)
+			{
+				OutTracks.Add(Track);
+			}
+		}
+	}
+}
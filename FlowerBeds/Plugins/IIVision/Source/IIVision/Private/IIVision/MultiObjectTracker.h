@@ -0,0 +1,69 @@
+#pragma once
+
+#include "IIVision/BlobTracker.h"
+
+namespace II::Vision
+{
+	/**
+	 * Follows 3D blobs from frame to frame and gives them persistent ids.
+	 * Each frame, every (track, blob) pair within the gate radius is a candidate match. Candidates are found through
+	 * a spatial hash of the blobs with gate radius sized cells, so each track only looks at the blobs in the cells
+	 * around it, then matched greedily, closest first. That's O(n log n) in the number of candidates, rather than the
+	 * O(n^3) of an optimal assignment, and with a gate smaller than the space between people it picks the same pairs.
+	 * New tracks are tentative until they've been matched MinHitsToConfirm frames in a row, and a tentative track
+	 * that misses a frame is dropped straight away, so flickering noise never gets an id anyone sees. Confirmed
+	 * tracks coast through up to MaxMissesToKeep missed frames before they're dropped.
+	 * Positions are Kalman filtered, each axis on its own with a constant velocity model. Tracks are gated at where
+	 * the filter expects them on the new frame rather than where they were on the last, and coast along their
+	 * velocity while they're missed.
+	 */
+	class FMultiObjectTracker
+	{
+	public:
+		using FBlob3D = FBlobTracker::FBlob3D;
+		using FTrack = FBlobTracker::FTrack;
+		using FTrackingConfig = FBlobTracker::FTrackingConfig;
+		
+		void Configure(const FTrackingConfig& InConfig);
+		
+		/**
+		 * Matches this frame's blobs to the existing tracks, and writes out the confirmed ones.
+		 * Blobs that aren't bValid are ignored. TimestampUs is the frame's.
+		 */
+		void Update(const TArray<FBlob3D>& Blobs, uint64 TimestampUs, TArray<FTrack>& OutTracks);
+		
+		void Reset();
+	
+	private:
+		struct FCandidate
+		{
+			float DistSquared = 0.0f;
+			int32 TrackIdx = INDEX_NONE;
+			int32 BlobIdx = INDEX_NONE;
+		};
+		
+		// The filter state is the track's position and velocity, its covariance lives alongside, per axis
+		struct FTrackState
+		{
+			FTrack Track{};
+			FVector PosVariance = FVector::ZeroVector;
+			FVector PosVelCovariance = FVector::ZeroVector;
+			FVector VelVariance = FVector::ZeroVector;
+		};
+		
+		FTrackingConfig Config{};
+		TArray<FTrackState> Tracks{};
+		int32 NextTrackId = 0;
+		
+		// Scratch, kept between frames for the allocations
+		TMultiMap<FIntVector, int32> BlobGrid{};
+		TArray<FCandidate> Candidates{};
+		TArray<int32> BlobTrackIdx{};
+		TArray<bool> TrackMatched{};
+		
+		FIntVector GetCell(const FVector& PosMeters) const;
+		void StartTrack(const FBlob3D& Blob, int32 BlobIdx, uint64 TimestampUs);
+		void PredictTrack(FTrackState& State, uint64 TimestampUs) const;
+		void CorrectTrack(FTrackState& State, const FVector& MeasuredPosMeters) const;
+	};
+}
@@ -0,0 +1,263 @@
+#include "IIVision/RunLabeller.h"
+
+#include "IIVision/DepthKernels.h"
+
+namespace II::Vision
+{
+	void FRunLabeller::Reset(const int32 InWidth)
+	{
+		Width = InWidth;
+		NumMaskWords = Kernels::GetNumMaskWords(Width);
+		
+		// Keep the allocations around between frames
+		Runs.Reset();
+		Parents.Reset();
+		Stats.Reset();
+		BlobIds.Reset();
+		
+		FirstY = INDEX_NONE;
+		LastY = INDEX_NONE;
+		LastRowBegin = 0;
+	}
+
+	void FRunLabeller::AddRow(const int32 Y, const uint64* Bits)
+	{
+		// Only connect to the previous row if it's directly above this one
+		const bool bHasRowAbove = LastY != INDEX_NONE && Y == LastY + 1;
+		const int32 PrevRowEnd = Runs.Num();
+		int32 PrevRunIdx = bHasRowAbove ? LastRowBegin : PrevRowEnd;
+		
+		if (FirstY == INDEX_NONE)
+		{
+			FirstY = Y;
+		}
+		
+		LastY = Y;
+		LastRowBegin = Runs.Num();
+		
+		int32 RunStart = INDEX_NONE;
+		
+		for (int32 WordIdx = 0; WordIdx < NumMaskWords; ++WordIdx)
+		{
+			const uint64 Word = Bits[WordIdx];
+			const int32 WordX = WordIdx * 64;
+			int32 Bit = 0;
+			
+			// Jump from edge to edge with bit scans rather than walking pixels
+			while (Bit < 64)
+			{
+				if (RunStart == INDEX_NONE)
+				{
+					const uint64 Remaining = Word >> Bit;
+					
+					if (Remaining == 0)
+					{
+						break;
+					}
+					
+					Bit += FMath::CountTrailingZeros64(Remaining);
+					RunStart = WordX + Bit;
+				}
+				else
+				{
+					const uint64 Remaining = ~Word >> Bit;
+					
+					// The run carries on into the next word
+					if (Remaining == 0)
+					{
+						break;
+					}
+					
+					Bit += FMath::CountTrailingZeros64(Remaining);
+					AddRun(Y, RunStart, WordX + Bit - 1, PrevRunIdx, PrevRowEnd);
+					RunStart = INDEX_NONE;
+				}
+			}
+		}
+		
+		// A run that touches the right edge of a row that's a multiple of 64 wide
+		if (RunStart != INDEX_NONE)
+		{
+			AddRun(Y, RunStart, Width - 1, PrevRunIdx, PrevRowEnd);
+		}
+	}
+
+	void FRunLabeller::AddRun(const int32 Y, const int32 X0, const int32 X1, int32& PrevRunIdx, const int32 PrevRowEnd)
+	{
+		int32 Label = ConnectToRowAbove(INDEX_NONE, X0, X1, PrevRunIdx, PrevRowEnd);
+		
+		// New component
+		if (Label == INDEX_NONE)
+		{
+			Label = Parents.Num();
+			Parents.Add(Label);
+			Stats.AddDefaulted();
+		}
+		
+		Stats[Label].AddRun(X0, X1, Y);
+		Runs.Add({ Y, X0, X1, Label });
+	}
+
+	int32 FRunLabeller::ConnectToRowAbove(
+		int32 Label,
+		const int32 X0,
+		const int32 X1,
+		int32& PrevRunIdx,
+		const int32 PrevRowEnd)
+	{
+		// Skip the runs above that end before this one could touch them (diagonals count)
+		while (PrevRunIdx < PrevRowEnd && Runs[PrevRunIdx].X1 < X0 - 1)
+		{
+			++PrevRunIdx;
+		}
+		
+		// Merge with every run above that touches this one. Don't advance PrevRunIdx past them, the next run in
+		// this row might touch the last one too.
+		for (int32 RunIdx = PrevRunIdx; RunIdx < PrevRowEnd && Runs[RunIdx].X0 <= X1 + 1; ++RunIdx)
+		{
+			Label = Label == INDEX_NONE ? FindRoot(Runs[RunIdx].Label) : Union(Label, Runs[RunIdx].Label);
+		}
+		
+		return Label;
+	}
+
+	void FRunLabeller::Append(const FRunLabeller& Other)
+	{
+		check(Width == Other.Width);
+		
+		if (Other.LastY == INDEX_NONE)
+		{
+			return;
+		}
+		
+		const bool bHasRowAbove = LastY != INDEX_NONE && Other.FirstY == LastY + 1;
+		const int32 PrevRowBegin = LastRowBegin;
+		const int32 PrevRowEnd = Runs.Num();
+		const int32 LabelOffset = Parents.Num();
+		
+		Parents.Reserve(LabelOffset + Other.Parents.Num());
+		
+		for (const int32 Parent : Other.Parents)
+		{
+			Parents.Add(Parent + LabelOffset);
+		}
+		
+		Stats.Append(Other.Stats);
+		Runs.Reserve(PrevRowEnd + Other.Runs.Num());
+		
+		for (const FRun& Run : Other.Runs)
+		{
+			Runs.Add({ Run.Y, Run.X0, Run.X1, Run.Label + LabelOffset });
+		}
+		
+		// Stitch the seam. Everything else was already connected by Other.
+		if (bHasRowAbove)
+		{
+			int32 PrevRunIdx = PrevRowBegin;
+			
+			for (int32 RunIdx = PrevRowEnd; RunIdx < Runs.Num() && Runs[RunIdx].Y == Other.FirstY; ++RunIdx)
+			{
+				const FRun& Run = Runs[RunIdx];
+				ConnectToRowAbove(Run.Label, Run.X0, Run.X1, PrevRunIdx, PrevRowEnd);
+			}
+		}
+		
+		if (FirstY == INDEX_NONE)
+		{
+			FirstY = Other.FirstY;
+		}
+		
+		LastY = Other.LastY;
+		LastRowBegin = PrevRowEnd + Other.LastRowBegin;
+	}
+
+	int32 FRunLabeller::FindRoot(int32 Label)
+	{
+		while (Parents[Label] != Label)
+		{
+			// Path halving
+			Parents[Label] = Parents[Parents[Label]];
+			Label = Parents[Label];
+		}
+		
+		return Label;
+	}
+
+	int32 FRunLabeller::Union(const int32 LabelA, const int32 LabelB)
+	{
+		const int32 RootA = FindRoot(LabelA);
+		const int32 RootB = FindRoot(LabelB);
+		
+		if (RootA == RootB)
+		{
+			return RootA;
+		}
+		
+		// The smaller label is always the root, so roots stay in raster order
+		const int32 Root = FMath::Min(RootA, RootB);
+		const int32 Child = FMath::Max(RootA, RootB);
+		
+		Parents[Child] = Root;
+		Stats[Root].Merge(Stats[Child]);
+		
+		return Root;
+	}
+
+	void FRunLabeller::Finish(const int32 MinBlobPixels, TArray<FBlob2D>& OutBlobs)
+	{
+		OutBlobs.Reset();
+		BlobIds.SetNumUninitialized(Parents.Num());
+		
+		for (int32 Label = 0; Label < Parents.Num(); ++Label)
+		{
+			// A root is smaller than everything in its set, so non-roots always see their root's id already set
+			if (const int32 Root = FindRoot(Label); Root != Label)
+			{
+				BlobIds[Label] = BlobIds[Root];
+			}
+			else if (Stats[Label].PixelCount >= MinBlobPixels)
+			{
+				BlobIds[Label] = OutBlobs.Num();
+				
+				FBlob2D& Blob = OutBlobs.Add_GetRef(Stats[Label]);
+				Blob.Id = BlobIds[Label];
+			}
+			else
+			{
+				BlobIds[Label] = INDEX_NONE;
+			}
+		}
+	}
+
+	void FRunLabeller::PaintLabels(const int32 Height, TArray<int32>& OutLabels) const
+	{
+		OutLabels.SetNumUninitialized(Width * Height);
+		
+		// Memset only works for INDEX_NONE because all of its bytes are the same
+		static_assert(INDEX_NONE == -1);
+		FMemory::Memset(OutLabels.GetData(), 0xFF, OutLabels.Num() * sizeof(int32));
+		
+		for (const FRun& Run : Runs)
+		{
+			if (const int32 BlobId = GetBlobId(Run); BlobId != INDEX_NONE)
+			{
+				int32* Row = OutLabels.GetData() + Run.Y * Width;
+				
+				for (int32 x = Run.X0; x <= Run.X1; ++x)
+				{
+					Row[x] = BlobId;
+				}
+			}
+		}
+	}
+
+	const TArray<FRunLabeller::FRun>& FRunLabeller::GetRuns() const
+	{
+		return Runs;
+	}
+
+	int32 FRunLabeller::GetBlobId(const FRun& Run) const
+	{
+		return BlobIds[Run.Label];
+	}
+}
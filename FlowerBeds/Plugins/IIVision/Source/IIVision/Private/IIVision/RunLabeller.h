@@ -0,0 +1,83 @@
+#pragma once
+
+#include "IIVision/BlobTracker.h"
+
+namespace II::Vision
+{
+	/**
+	 * Run-based, 8-connected component labelling over a bit-packed mask.
+	 * Rows are fed in top to bottom. Each horizontal run of set pixels gets the label of the runs it touches in the
+	 * row above (merging them with union-find), or a new label. Blob stats are accumulated per label as the runs come
+	 * in and merged on union, so Finish only has to walk the labels, not the pixels.
+	 * A label's root is always the smallest label in its set, which is the label of the component's first run in
+	 * raster order, so blobs come out in the same order no matter how the runs were merged.
+	 */
+	class FRunLabeller
+	{
+	public:
+		using FBlob2D = FBlobTracker::FBlob2D;
+		
+		struct FRun
+		{
+			int32 Y = 0;
+			int32 X0 = 0;
+			
+			// Inclusive
+			int32 X1 = 0;
+			
+			int32 Label = INDEX_NONE;
+		};
+		
+		void Reset(int32 InWidth);
+		
+		/**
+		 * Extracts the runs of row Y and connects them to the runs of row Y - 1, if that was the last row added.
+		 */
+		void AddRow(int32 Y, const uint64* Bits);
+		
+		/**
+		 * Appends the runs and labels of a labeller that was fed the rows below this one's, e.g. the next band down
+		 * of the same frame. Its first row gets connected to this one's last row.
+		 */
+		void Append(const FRunLabeller& Other);
+		
+		/**
+		 * Resolves the labels and writes out every component with at least MinBlobPixels pixels, in raster order of
+		 * their first pixel. Blob ids are their index in OutBlobs.
+		 */
+		void Finish(int32 MinBlobPixels, TArray<FBlob2D>& OutBlobs);
+		
+		/**
+		 * Writes the blob id of every pixel (or INDEX_NONE) into OutLabels. Only valid after Finish.
+		 */
+		void PaintLabels(int32 Height, TArray<int32>& OutLabels) const;
+		
+		const TArray<FRun>& GetRuns() const;
+		
+		/**
+		 * The blob id a run ended up in, or INDEX_NONE if it was too small. Only valid after Finish.
+		 */
+		int32 GetBlobId(const FRun& Run) const;
+	
+	private:
+		int32 Width = 0;
+		int32 NumMaskWords = 0;
+		
+		TArray<FRun> Runs{};
+		int32 FirstY = INDEX_NONE;
+		int32 LastY = INDEX_NONE;
+		
+		// The runs of row LastY are [LastRowBegin, Runs.Num())
+		int32 LastRowBegin = 0;
+		
+		// Per label
+		TArray<int32> Parents{};
+		TArray<FBlob2D> Stats{};
+		TArray<int32> BlobIds{};
+		
+		void AddRun(int32 Y, int32 X0, int32 X1, int32& PrevRunIdx, int32 PrevRowEnd);
+		int32 ConnectToRowAbove(int32 Label, int32 X0, int32 X1, int32& PrevRunIdx, int32 PrevRowEnd);
+		int32 FindRoot(int32 Label);
+		int32 Union(int32 LabelA, int32 LabelB);
+	};
+}
@@ -0,0 +1,189 @@
+#include "IIVision/RvlCodec.h"
+
+namespace II::Vision::Rvl
+{
+	namespace
+	{
+		// Packs 4 bit groups into 32 bit words, most significant first
+		struct FNibbleWriter
+		{
+			uint8* Out = nullptr;
+			uint32 Word = 0;
+			int32 NumNibbles = 0;
+			
+			// 3 bits of value per nibble, with the top bit set if there's more to come
+			void WriteVle(uint32 Value)
+			{
+				do
+				{
+					uint32 Nibble = Value & 0x7;
+					Value >>= 3;
+					
+					if (Value)
+					{
+						Nibble |= 0x8;
+					}
+					
+					Word = (Word << 4) | Nibble;
+					
+					if (++NumNibbles == 8)
+					{
+						FlushWord();
+					}
+				}
+				while (Value);
+			}
+			
+			void Finish()
+			{
+				if (NumNibbles)
+				{
+					Word <<= 4 * (8 - NumNibbles);
+					FlushWord();
+				}
+			}
+			
+			void FlushWord()
+			{
+				FMemory::Memcpy(Out, &Word, sizeof(Word));
+				Out += sizeof(Word);
+				Word = 0;
+				NumNibbles = 0;
+			}
+		};
+
+		struct FNibbleReader
+		{
+			const uint8* In = nullptr;
+			const uint8* End = nullptr;
+			uint32 Word = 0;
+			int32 NumNibbles = 0;
+			
+			bool ReadVle(uint32& OutValue)
+			{
+				OutValue = 0;
+				
+				for (int32 Shift = 0; Shift < 32; Shift += 3)
+				{
+					if (!NumNibbles)
+					{
+						if (End - In < static_cast<int64>(sizeof(Word)))
+						{
+							return false;
+						}
+						
+						FMemory::Memcpy(&Word, In, sizeof(Word));
+						In += sizeof(Word);
+						NumNibbles = 8;
+					}
+					
+					const uint32 Nibble = Word >> 28;
+					Word <<= 4;
+					--NumNibbles;
+					
+					OutValue |= (Nibble & 0x7) << Shift;
+					
+					if (!(Nibble & 0x8))
+					{
+						return true;
+					}
+				}
+				
+				// Too many groups for 32 bits, so it's garbage
+				return false;
+			}
+		};
+	}
+
+	int32 GetMaxCompressedSize(const int32 NumPixels)
+	{
+		// At worst a pixel takes a word: 6 nibbles for a maximal delta (17 bits zigzagged, 3 per nibble), plus the run
+		// lengths either side of it. Plus a word for the run lengths at the end, and one for rounding.
+		return (NumPixels + 2) * sizeof(uint32);
+	}
+
+	int32 Compress(const uint16* DepthMm, const int32 NumPixels, uint8* Out)
+	{
+		FNibbleWriter Writer{ Out };
+		const uint16* const End = DepthMm + NumPixels;
+		int32 Previous = 0;
+		
+		while (DepthMm != End)
+		{
+			const uint16* RunStart = DepthMm;
+			
+			while (DepthMm != End && !*DepthMm)
+			{
+				++DepthMm;
+			}
+			
+			Writer.WriteVle(DepthMm - RunStart);
+			RunStart = DepthMm;
+			
+			const uint16* RunEnd = DepthMm;
+			
+			while (RunEnd != End && *RunEnd)
+			{
+				++RunEnd;
+			}
+			
+			Writer.WriteVle(RunEnd - RunStart);
+			
+			for (; DepthMm != RunEnd; ++DepthMm)
+			{
+				// Zigzag, so small negative deltas are small too
+				const int32 Delta = *DepthMm - Previous;
+				Writer.WriteVle((static_cast<uint32>(Delta) << 1) ^ static_cast<uint32>(Delta >> 31));
+				Previous = *DepthMm;
+			}
+		}
+		
+		Writer.Finish();
+		return Writer.Out - Out;
+	}
+
+	bool Decompress(const uint8* In, const int32 NumBytes, uint16* OutDepthMm, const int32 NumPixels)
+	{
+		FNibbleReader Reader{ In, In + NumBytes };
+		int32 NumRemaining = NumPixels;
+		int32 Previous = 0;
+		
+		while (NumRemaining > 0)
+		{
+			uint32 NumZeros;
+			
+			if (!Reader.ReadVle(NumZeros) || NumZeros > static_cast<uint32>(NumRemaining))
+			{
+				return false;
+			}
+			
+			FMemory::Memzero(OutDepthMm, NumZeros * sizeof(uint16));
+			OutDepthMm += NumZeros;
+			NumRemaining -= NumZeros;
+			
+			uint32 NumNonZeros;
+			
+			if (!Reader.ReadVle(NumNonZeros) || NumNonZeros > static_cast<uint32>(NumRemaining))
+			{
+				return false;
+			}
+			
+			NumRemaining -= NumNonZeros;
+			
+			for (; NumNonZeros; --NumNonZeros)
+			{
+				uint32 Zigzag;
+				
+				if (!Reader.ReadVle(Zigzag))
+				{
+					return false;
+				}
+				
+				Previous += static_cast<int32>(Zigzag >> 1) ^ -static_cast<int32>(Zigzag & 1);
+				*OutDepthMm++ = static_cast<uint16>(Previous);
+			}
+		}
+		
+		return true;
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * RVL lossless depth compression (Wilson, "Fast Lossless Depth Image Compression", 2017).
+ * Alternates runs of zeros and non-zeros, and stores the non-zeros as deltas from the previous one, all as variable
+ * length 4 bit groups. Depth images have lots of holes and smooth surfaces, so this gets most of what a general
+ * purpose compressor would at a fraction of the cost: a single pass, no tables.
+ */
+namespace II::Vision::Rvl
+{
+	// Big enough for any NumPixels depths, however badly they compress
+	int32 GetMaxCompressedSize(int32 NumPixels);
+
+	/**
+	 * Compresses NumPixels depths into Out, which must have room for GetMaxCompressedSize bytes.
+	 * Returns the number of bytes written.
+	 */
+	int32 Compress(const uint16* DepthMm, int32 NumPixels, uint8* Out);
+
+	/**
+	 * Decompresses exactly NumPixels depths. Returns false if In runs out or holds more pixels than that, in which
+	 * case OutDepthMm is left partly written.
+	 */
+	bool Decompress(const uint8* In, int32 NumBytes, uint16* OutDepthMm, int32 NumPixels);
+}
@@ -0,0 +1,132 @@
+#include "IIVision/VisionWorker.h"
+
+#include "HAL/Event.h"
+#include "HAL/RunnableThread.h"
+
+namespace II::Vision
+{
+	FVisionWorker::FVisionWorker(
+		const FString& Name,
+		const int32 InNumCalibrationFrames,
+		const FBlobTracker::FDetectionConfig& DetectionConfig,
+		const FString& RecordingPath)
+		: NumCalibrationFrames(InNumCalibrationFrames)
+	{
+		BlobTracker.ConfigureDetection(DetectionConfig);
+		
+		if (!RecordingPath.IsEmpty())
+		{
+			RecordingWriter = FDepthRecordingWriter::Create(RecordingPath);
+		}
+		
+		FrameReadyEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		Thread = FRunnableThread::Create(this, *Name, 0, TPri_AboveNormal);
+	}
+
+	FVisionWorker::~FVisionWorker()
+	{
+		if (Thread)
+		{
+			// Calls Stop and waits for Run to return
+			Thread->Kill(true);
+			delete Thread;
+			Thread = nullptr;
+		}
+		
+		FPlatformProcess::ReturnSynchEventToPool(FrameReadyEvent);
+		FrameReadyEvent = nullptr;
+	}
+
+	void FVisionWorker::PushFrame(const FFramePacket& Frame)
+	{
+		InputFrames.GetWriteBuffer() = Frame;
+		InputFrames.Publish();
+		FrameReadyEvent->Trigger();
+		
+		// The new write buffer may still hold a frame the worker skipped. Let its data go now, rather than whenever
+		// the next frame comes in, as it may be one of the camera SDK's own.
+		InputFrames.GetWriteBuffer() = FFramePacket();
+	}
+
+	const FVisionWorker::FOutput* FVisionWorker::TryGetLatestOutput()
+	{
+		return Outputs.Consume() ? &Outputs.GetReadBuffer() : nullptr;
+	}
+
+	uint32 FVisionWorker::Run()
+	{
+		while (!bStopRequested)
+		{
+			FrameReadyEvent->Wait();
+			
+			// Several pushes may have come in since the last wait, but we only want the newest
+			if (!bStopRequested && InputFrames.Consume())
+			{
+				ProcessFrame(InputFrames.GetReadBuffer());
+				
+				// Likewise let go of the one we're done with
+				InputFrames.GetReadBuffer() = FFramePacket();
+			}
+		}
+		
+		return 0;
+	}
+
+	void FVisionWorker::Stop()
+	{
+		bStopRequested = true;
+		FrameReadyEvent->Trigger();
+	}
+
+	void FVisionWorker::ProcessFrame(const FFramePacket& Frame)
+	{
+		if (Frame.DepthMm.IsEmpty())
+		{
+			return;
+		}
+		
+		if (RecordingWriter)
+		{
+			RecordingWriter->WriteFrame(Frame);
+		}
+		
+		// This buffer holds whatever was published a couple of frames ago. Don't let old blobs leak through if we
+		// don't end up detecting anything this frame.
+		FOutput& Output = Outputs.GetWriteBuffer();
+		Output.DetectionResult.ScreenSpaceBlobs.Reset();
+		Output.DetectionResult.WorldSpaceBlobs.Reset();
+		Output.DetectionResult.Tracks.Reset();
+		
+		switch (BlobTracker.GetCalibrationState())
+		{
+		case FBlobTracker::ECalibrationState::NotCalibrated:
+			BlobTracker.BeginCalibration(NumCalibrationFrames, Frame.Width, Frame.Height);
+			BlobTracker.PushCalibrationFrame(Frame);
+			break;
+		case FBlobTracker::ECalibrationState::CalibrationInProgress:
+			BlobTracker.PushCalibrationFrame(Frame);
+			break;
+		case FBlobTracker::ECalibrationState::Calibrated:
+			BlobTracker.Detect(Frame, Output.DetectionResult);
+			break;
+		}
+		
+		// Snapshot the background whenever it changes, so the game thread can read it without racing us
+		const bool bIsCalibrated = BlobTracker.GetCalibrationState() == FBlobTracker::ECalibrationState::Calibrated;
+		
+		if (bIsCalibrated && BlobTracker.GetBackgroundVersion() != BackgroundVersion)
+		{
+			BackgroundDepthMm = MakeShared<const TArray<uint16>>(BlobTracker.GetBackgroundDepthMm());
+			BackgroundVersion = BlobTracker.GetBackgroundVersion();
+		}
+		
+		Output.CalibrationState = BlobTracker.GetCalibrationState();
+		Output.CalibrationProgress = BlobTracker.GetCalibrationProgress();
+		Output.Width = BlobTracker.GetWidth();
+		Output.Height = BlobTracker.GetHeight();
+		Output.TimestampUs = Frame.TimestampUs;
+		Output.BackgroundDepthMm = BackgroundDepthMm;
+		
+		Outputs.Publish();
+	}
+}
@@ -1,18 +1,38 @@
 #pragma once
 
 #include "FramePacket.h"
+#include "Tasks/Task.h"
 
 namespace II::Vision
 {
+	class FRunLabeller;
+	class FMultiObjectTracker;
+	
+	namespace Kernels
+	{
+		struct FSubtractBackgroundParams;
+	}
+	
 	class IIVISION_API FBlobTracker
 	{
 	public:
+		FBlobTracker();
+		~FBlobTracker();
+		
 		struct FCalibrationConfig
 		{
 			uint16 MinDepthMM = 50;
 			uint16 MaxDepthMM = 6000;
+			
+			// How far the background can move per frame while calibrating, in mm
+			uint16 CalibrationMaxStepMM = 1024;
 		};
 		
+		/**
+		 * The background is a streaming per-pixel approximate median, so calibration frames get folded in as they
+		 * arrive and memory doesn't depend on NumCalibrationFrames. Calibration only decides how many frames to fold in
+		 * before detection can start.
+		 */
 		void BeginCalibration(int32 NumCalibrationFrames, int32 InWidth, int32 InHeight);
 		void PushCalibrationFrame(const FFramePacket& Frame);
 		
@@ -25,20 +45,41 @@ namespace II::Vision
 		
 		ECalibrationState GetCalibrationState() const;
 		
+		// 0 to 1, the fraction of calibration frames pushed so far
+		float GetCalibrationProgress() const;
+		
 		int32 GetWidth() const;
 		int32 GetHeight() const;
 		const TArray<uint16>& GetBackgroundDepthMm() const;
 		const TArray<bool>& GetValidMask() const;
 		
+		// Bumped every time the background Detect subtracts changes
+		uint32 GetBackgroundVersion() const;
+		
 		struct FDetectionConfig
 		{
 			uint16 MinDepthMM = 500;
 			uint16 MaxDepthMM = 6000;
 			int32 DepthDeltaMM = 80;
 			int32 MinBlobPixels = 500;
-			int32 StridePixels = 3;
+			int32 StridePixels = 1;
 			int32 MinSamples = 40;
 			int32 ZWindowMm = 150;
+			
+			// Subtract, despeckle and label in a single sweep over the rows, keeping only a few rows of each stage
+			// in flight instead of whole-frame intermediate masks. Gives the same result.
+			bool bFusedPipeline = false;
+			
+			// If > 1, split the frame into this many bands of rows and sweep each one as above, in parallel on the
+			// task graph, then stitch blobs back together across the band edges. Gives the same result.
+			int32 NumParallelBands = 0;
+			
+			// After calibration, keep folding this fraction of frames into the background, except where there are
+			// blobs, so it follows slow changes in the scene. Runs on a task and never holds up Detect. 0 turns it off.
+			float BackgroundLearningRate = 0.1f;
+			
+			// How far the background can move per folded frame, in mm
+			uint16 BackgroundAdaptMaxStepMM = 2;
 		};
 		
 		void ConfigureDetection(FDetectionConfig Config);
@@ -56,6 +97,11 @@ namespace II::Vision
 			
 			void AddPixel(int32 X, int32 Y);
 			
+			// X1 is inclusive
+			void AddRun(int32 X0, int32 X1, int32 Y);
+			
+			void Merge(const FBlob2D& Other);
+			
 			FVector2f GetCentroid() const;
 		};
 		
@@ -75,43 +121,206 @@ namespace II::Vision
 			FVector GetWorldHalfExtentsCm() const;
 		};
 		
+		/**
+		 * A blob followed across frames. Id stays the same for as long as the track lives, and is never reused.
+		 * The position is Kalman filtered, with a constant velocity model per axis, so it's smoother than the raw
+		 * blobs and carries a velocity to predict with.
+		 */
+		struct IIVISION_API FTrack
+		{
+			int32 Id = INDEX_NONE;
+			
+			// Index into this frame's WorldSpaceBlobs, or INDEX_NONE if the track missed this frame and is coasting
+			int32 BlobIdx = INDEX_NONE;
+			
+			// Consecutive frames matched, and missed
+			int32 NumHits = 0;
+			int32 NumMisses = 0;
+			bool bConfirmed = false;
+			
+			// The last blob matched, with Id set to the track's and CamPosMeters replaced by the filtered position
+			FBlob3D Blob{};
+			
+			// In camera coordinate space
+			FVector CamVelocityMetersPerSec = FVector::ZeroVector;
+			
+			// Of the frame Blob and CamVelocityMetersPerSec are estimated at, in the frames' clock
+			uint64 TimestampUs = 0;
+			
+			/**
+			 * Blob, moved on to where it's expected to be at InTimestampUs, in the frames' clock. Pass a time ahead of
+			 * the frame to make up for latency downstream.
+			 */
+			FBlob3D PredictAt(uint64 InTimestampUs) const;
+		};
+		
+		struct FTrackingConfig
+		{
+			// How far a blob can move between frames and still be matched to the same track
+			float GateRadiusMeters = 0.5f;
+			
+			// Frames a new track has to be matched in a row before it's reported
+			int32 MinHitsToConfirm = 3;
+			
+			// Frames a confirmed track can go unmatched before it's dropped
+			int32 MaxMissesToKeep = 10;
+			
+			// Kalman filter noise. Raise the acceleration to follow quick changes in direction more closely, raise the
+			// measurement noise to smooth more.
+			float AccelerationNoiseMetersPerSecSq = 2.0f;
+			float MeasurementNoiseMeters = 0.03f;
+		};
+		
+		void ConfigureTracking(const FTrackingConfig& Config);
+		
 		struct FDetectionResult
 		{
+			// Of the frame this was detected in
+			uint64 TimestampUs = 0;
+			
 			TArray<uint8> Foreground;
+			
+			// Per pixel index into ScreenSpaceBlobs, or INDEX_NONE
+			TArray<int32> Labels;
+			
 			TArray<FBlob2D> ScreenSpaceBlobs;
 			TArray<FBlob3D> WorldSpaceBlobs;
+			
+			// Confirmed tracks, with persistent ids. Includes tracks coasting through a missed frame.
+			TArray<FTrack> Tracks;
 		};
 		
 		void Detect(const FFramePacket& Frame, FDetectionResult& OutResult);
 		
+		// How long each stage of the last Detect took, in seconds. Stages that didn't run are 0.
+		struct FStageTimings
+		{
+			double SubtractBackground = 0.0;
+			double MajorityFilter = 0.0;
+			double ExtractBlobs = 0.0;
+			
+			// All three of the above in one, with the fused pipeline
+			double FusedSweep = 0.0;
+			
+			double Compute3DBlobs = 0.0;
+			double Tracking = 0.0;
+		};
+		
+		const FStageTimings& GetLastStageTimings() const;
+		
+		/**
+		 * Every pixel of the frame back-projected into camera space, in meters, image shaped. Pixels with no reading
+		 * come out as (0, 0, 0).
+		 */
+		struct FPointCloud
+		{
+			int32 Width = 0;
+			int32 Height = 0;
+			TArray<float> X;
+			TArray<float> Y;
+			TArray<float> Z;
+		};
+		
+		/**
+		 * Shares its back-projection tables with Detect and may rebuild them, so only call this from the thread that
+		 * calls Detect, e.g. the FVisionWorker's.
+		 */
+		void ComputePointCloud(const FFramePacket& Frame, FPointCloud& OutPointCloud);
+		
 	private:
-		constexpr static int32 MaxCalibrationFrames = 128;
 		constexpr static int32 MinFramesValid = 10;
 		
-		// NB: CalibrationFrames is stored in contiguous memory for speed
 		FCalibrationConfig CalibrationConfig{};
-		TArray<uint16> CalibrationFrames{};
 		int32 Width = 0;
 		int32 Height = 0;
+		int32 NumCalibrationFramesTotal = 0;
 		int32 NumCalibrationFramesRemaining = 0;
 		
 		void EndCalibration();
-		void ComputeBackground();
+		void FoldRowIntoBackground(int32 Y, const uint16* DepthMm, uint16 MaxStepMm, const uint64* ExcludeMask);
+		
+		struct FBackground
+		{
+			TArray<uint16> DepthMm{};
+			TArray<bool> ValidMask{};
+			
+			// Precomputed from the two above and the detection config, see Kernels::ComputeForegroundMaxDepth. This
+			// is all SubtractBackground reads.
+			TArray<uint16> ForegroundMaxDepthMm{};
+		};
+		
+		void WriteBackground(const Kernels::FSubtractBackgroundParams& Params, FBackground& OutBackground) const;
+		
+		// Per pixel background model, see Kernels::UpdateBackgroundModel. Only touched by calibration and the adapt
+		// task, never by Detect.
+		TArray<uint16> ModelDepthMm{};
+		TArray<uint16> ModelStepMm{};
+		TArray<uint16> NumModelSamples{};
+		
+		// The background Detect subtracts. Double buffered: the adapt task writes AdaptedBackground from the model,
+		// and Detect swaps it in once the task is done.
+		FBackground Background{};
+		FBackground AdaptedBackground{};
+		uint32 BackgroundVersion = 0;
 		
-		TArray<uint16> BackgroundDepthMm{};
-		TArray<bool> ValidMask{};
+		// Pixels in blobs on the frame being adapted to, packed 1 bit per pixel
+		TArray<uint64> AdaptExcludeMask{};
+		float AdaptCredit = 0.0f;
+		UE::Tasks::FTask AdaptTask{};
+		
+		void SwapInAdaptedBackground();
+		void LaunchBackgroundAdapt(const FFramePacket& Frame);
+		void WaitForBackgroundAdapt();
 		
 		ECalibrationState CalibrationState = ECalibrationState::NotCalibrated;
 		
 		FDetectionConfig DetectionConfig{};
-		TArray<uint8> ForegroundScratchBuffer{};
+		FStageTimings StageTimings{};
+		
+		// 1 bit per pixel, with an all-zero row above and below the image so the filter needs no border checks
+		TArray<uint64> PackedForeground{};
+		TArray<uint64> PackedForegroundScratchBuffer{};
+		
+		TUniquePtr<FRunLabeller> Labeller;
+		TUniquePtr<FMultiObjectTracker> MultiObjectTracker;
+		
+		// Row buffers and labeller for sweeping one band of rows, one per band
+		struct FRowSweep;
+		TArray<TUniquePtr<FRowSweep>> RowSweeps;
 		
+		Kernels::FSubtractBackgroundParams MakeSubtractBackgroundParams() const;
 		void SubtractBackground(const FFramePacket& Frame, FDetectionResult& OutResult) const;
-		void MajorityFilter(const TArray<uint8>& Src, TArray<uint8>& Dst) const;
-		void ExtractBlobs(const TArray<uint8>& Foreground, TArray<FBlob2D>& OutBlobs) const;
+		void PackMask(const TArray<uint8>& Src, TArray<uint64>& Dst) const;
+		void UnpackMask(const TArray<uint64>& Src, TArray<uint8>& Dst) const;
+		void MajorityFilter(const TArray<uint64>& Src, TArray<uint64>& Dst) const;
+		void ExtractBlobs(const TArray<uint64>& Mask, FDetectionResult& OutResult);
+		void DetectFused(const FFramePacket& Frame, int32 NumBands, FDetectionResult& OutResult);
+		void SweepRows(const FFramePacket& Frame, int32 BeginY, int32 EndY, FRowSweep& Sweep, FDetectionResult& OutResult) const;
+		void PrepareRowSweeps(int32 NumSweeps);
+		
+		struct FDepthSample
+		{
+			uint16 X = 0;
+			uint16 Y = 0;
+			uint16 DepthMm = 0;
+		};
+		
+		// Back-projection ray coefficients: (x - Cx) / Fx per column and (y - Cy) / Fy per row, for RayIntrinsics
+		FCameraIntrinsics RayIntrinsics{};
+		TArray<float> RayX{};
+		TArray<float> RayY{};
+		
+		void UpdateRayTables(const FCameraIntrinsics& Intrinsics);
+		
+		// Scratch space for Compute3DBlobs. The runs of blob i are BlobRunIndices[BlobRunOffsets[i]..BlobRunOffsets[i + 1]).
+		TArray<int32> BlobRunOffsets{};
+		TArray<int32> BlobRunIndices{};
+		TArray<FDepthSample> BlobSamples{};
+		TArray<uint16> BlobSampleDepths{};
+		
 		void Compute3DBlobs(
 			const FFramePacket& Frame,
 			const TArray<FBlob2D>& ScreenSpaceBlobs, 
-			TArray<FBlob3D>& OutBlobs) const;
+			TArray<FBlob3D>& OutBlobs);
 	};
 }
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "FramePacket.h"
+#include "Tasks/Task.h"
+
+#include <atomic>
+
+class FArchive;
+
+namespace II::Vision
+{
+	/**
+	 * Depth recordings: a header, then one record per frame with its size, timestamp and intrinsics, and the depths
+	 * RVL compressed (see RvlCodec.h), which typically takes them to a third or less of their size.
+	 */
+	class IIVISION_API FDepthRecordingWriter
+	{
+	public:
+		// Null if the file can't be opened
+		static TUniquePtr<FDepthRecordingWriter> Create(const FString& Path);
+		
+		// Waits for any frames still to be written
+		~FDepthRecordingWriter();
+		
+		/**
+		 * Compresses and writes the frame on a background task, in order, so the caller doesn't wait on the disk.
+		 * Holds on to the frame's DataOwner until it's written. Only waits if MaxPendingFrames are still to be written.
+		 */
+		void WriteFrame(const FFramePacket& Frame);
+	
+	private:
+		static constexpr int32 MaxPendingFrames = 4;
+		
+		TUniquePtr<FArchive> Archive;
+		FString Path;
+		
+		// Only touched by the write tasks, which run one at a time
+		TArray<uint8> CompressedBuffer;
+		int32 NumFramesWritten = 0;
+		
+		// Each write task waits for the one before it, so waiting for the last one waits for them all
+		UE::Tasks::FTask LastWriteTask{};
+		std::atomic<int32> NumPendingFrames = 0;
+		
+		FDepthRecordingWriter(TUniquePtr<FArchive> InArchive, const FString& InPath);
+		
+		void WriteFrameNow(const FFramePacket& Frame);
+	};
+
+	/**
+	 * Reads back frames written by FDepthRecordingWriter, in order.
+	 */
+	class IIVISION_API FDepthRecordingReader
+	{
+	public:
+		// Null if the file can't be opened or isn't a depth recording
+		static TUniquePtr<FDepthRecordingReader> Open(const FString& Path);
+		~FDepthRecordingReader();
+		
+		/**
+		 * Reads the next frame. Returns false at the end of the recording, or if the rest of it is unreadable.
+		 * The frame's buffer gets reused once nobody else holds on to its DataOwner.
+		 */
+		bool ReadFrame(FFramePacket& OutFrame);
+		
+		// Back to the first frame
+		void Rewind();
+	
+	private:
+		TUniquePtr<FArchive> Archive;
+		int64 FirstFrameOffset = 0;
+		TArray<uint8> CompressedBuffer;
+		TSharedPtr<TArray<uint16>> DepthBuffer;
+		
+		explicit FDepthRecordingReader(TUniquePtr<FArchive> InArchive);
+	};
+}
@@ -15,7 +15,15 @@ namespace II::Vision
 		int32 Width = 0;
 		int32 Height = 0;
 		uint64 TimestampUs = 0;
-		TSharedPtr<TArray<uint8>> Data{};
+		
+		// When the frame reached the host, on the host's clock, so unlike TimestampUs it compares across cameras
+		uint64 SystemTimestampUs = 0;
+		
+		// Width * Height depths. Points into memory owned by DataOwner, which may be the camera SDK's own frame, so
+		// hold on to DataOwner rather than copying if the depths are needed for longer.
+		TConstArrayView<uint16> DepthMm{};
+		TSharedPtr<const void> DataOwner{};
+		
 		FCameraIntrinsics Intrinsics{};
 	};
 }
\ No newline at end of file
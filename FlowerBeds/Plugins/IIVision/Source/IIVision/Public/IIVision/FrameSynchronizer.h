@@ -0,0 +1,65 @@
+#pragma once
+
+#include "FramePacket.h"
+
+namespace II::Vision
+{
+	/**
+	 * Lines up frames from several cameras into bundles taken at the same moment, by their SystemTimestampUs.
+	 * Each camera's latest few frames are held. A bundle is due once every camera has a frame at least as new as the
+	 * last bundle, and is taken at the newest moment they all have covered, with each camera's frame closest to it.
+	 * Cameras with nothing within ToleranceUs of that moment are left out of the bundle, and cameras lagging the
+	 * newest frame by more than MaxWaitUs aren't waited for, so a camera that stalls or runs slow only drops out of
+	 * the bundles rather than holding up the rest. Frames older than a bundle are dropped, so like each camera on
+	 * its own, we only ever hand out the newest.
+	 * Not thread safe, push and pop from the same thread.
+	 */
+	class IIVISION_API FFrameSynchronizer
+	{
+	public:
+		struct FConfig
+		{
+			// Frames from different cameras this close together are taken to be the same moment
+			uint64 ToleranceUs = 20000;
+			
+			// How far behind the newest frame a camera can be before we stop waiting for it
+			uint64 MaxWaitUs = 50000;
+			
+			// Frames to hold per camera while waiting for the others. They keep their DataOwner alive while held.
+			int32 MaxFramesPerSource = 4;
+		};
+		
+		struct FBundle
+		{
+			// The moment the frames were taken, on the host's clock
+			uint64 SystemTimestampUs = 0;
+			
+			// One per camera, by source index. Frames with empty DepthMm are cameras with nothing for this moment.
+			TArray<FFramePacket> Frames;
+		};
+		
+		void Configure(const FConfig& InConfig);
+		
+		// Frames from a camera should arrive in order, anything older than what it last pushed is dropped
+		void PushFrame(int32 SourceIdx, const FFramePacket& Frame);
+		
+		// False if no new bundle is due
+		bool TryPopBundle(FBundle& OutBundle);
+		
+		void Reset();
+	
+	private:
+		struct FSource
+		{
+			// Oldest first, not yet handed out
+			TArray<FFramePacket> Frames;
+			
+			// The newest this camera has pushed, handed out or not
+			uint64 LatestTimestampUs = 0;
+		};
+		
+		FConfig Config{};
+		TArray<FSource> Sources;
+		uint64 LastBundleTimestampUs = 0;
+	};
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+
+namespace II::Vision
+{
+	/**
+	 * Lock-free single producer, single consumer triple buffer.
+	 * The producer fills the write buffer and publishes it, the consumer picks up the latest published buffer. Neither
+	 * side ever waits on the other: publishing swaps the write buffer with the spare one, and consuming swaps the read
+	 * buffer with the spare one if something new has been published since. Anything published but never consumed gets
+	 * overwritten, so the consumer always sees the latest value.
+	 * Buffers get reused, so a T that holds arrays keeps its allocations.
+	 */
+	template <typename T>
+	class TTripleBuffer
+	{
+	public:
+		TTripleBuffer() = default;
+		TTripleBuffer(const TTripleBuffer&) = delete;
+		TTripleBuffer& operator=(const TTripleBuffer&) = delete;
+		
+		/**
+		 * Producer only. The buffer to fill before calling Publish.
+		 */
+		T& GetWriteBuffer()
+		{
+			return Buffers[WriteIdx];
+		}
+		
+		/**
+		 * Producer only. Hands the write buffer over to the consumer and starts a new one.
+		 * The new write buffer holds stale data from an older publish, not a copy of the one just published.
+		 */
+		void Publish()
+		{
+			const uint8 Old = Spare.exchange(WriteIdx | DirtyBit, std::memory_order_acq_rel);
+			WriteIdx = Old & IndexMask;
+		}
+		
+		/**
+		 * Consumer only. Swaps in the latest published buffer, if there's been one since the last call.
+		 * Returns whether the read buffer changed.
+		 */
+		bool Consume()
+		{
+			if ((Spare.load(std::memory_order_relaxed) & DirtyBit) == 0)
+			{
+				return false;
+			}
+			
+			const uint8 Old = Spare.exchange(ReadIdx, std::memory_order_acq_rel);
+			ReadIdx = Old & IndexMask;
+			
+			return true;
+		}
+		
+		/**
+		 * Consumer only. The last consumed buffer, or a default T if nothing has been consumed yet.
+		 */
+		const T& GetReadBuffer() const
+		{
+			return Buffers[ReadIdx];
+		}
+		
+		/**
+		 * Consumer only. The last consumed buffer, to clear out once the consumer is done with it.
+		 */
+		T& GetReadBuffer()
+		{
+			return Buffers[ReadIdx];
+		}
+	
+	private:
+		constexpr static uint8 IndexMask = 0x3;
+		constexpr static uint8 DirtyBit = 0x4;
+		
+		T Buffers[3]{};
+		
+		// Owned by the producer
+		uint8 WriteIdx = 0;
+		
+		// Owned by the consumer
+		uint8 ReadIdx = 1;
+		
+		// The index of the buffer in between, plus DirtyBit if it was published and not consumed yet
+		std::atomic<uint8> Spare{ 2 };
+	};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "BlobTracker.h"
+#include "DepthRecording.h"
+#include "TripleBuffer.h"
+#include "HAL/Runnable.h"
+
+class FRunnableThread;
+class FEvent;
+
+namespace II::Vision
+{
+	/**
+	 * Runs a blob tracker for one camera on its own thread.
+	 * Frames get pushed in from the game thread, the worker calibrates on the first NumCalibrationFrames of them and
+	 * runs detection on the rest, and the latest result is picked up by the game thread on tick. Both sides go through
+	 * triple buffers, so neither ever blocks on the other, and if the worker falls behind it skips straight to the
+	 * newest frame rather than queueing them up.
+	 */
+	class IIVISION_API FVisionWorker : public FRunnable
+	{
+	public:
+		struct FOutput
+		{
+			FBlobTracker::ECalibrationState CalibrationState = FBlobTracker::ECalibrationState::NotCalibrated;
+			float CalibrationProgress = 0.0f;
+			int32 Width = 0;
+			int32 Height = 0;
+			
+			// Of the frame this was computed from
+			uint64 TimestampUs = 0;
+			
+			// Set once calibration is done, and replaced whenever the background adapts. Never modified, so a new
+			// pointer means a new background.
+			TSharedPtr<const TArray<uint16>> BackgroundDepthMm{};
+			
+			// Only filled in once calibrated
+			FBlobTracker::FDetectionResult DetectionResult{};
+		};
+		
+		/**
+		 * If RecordingPath is set, every frame the worker processes gets recorded there, so a replay of it puts the
+		 * tracker through exactly what it saw.
+		 */
+		FVisionWorker(
+			const FString& Name, 
+			int32 InNumCalibrationFrames, 
+			const FBlobTracker::FDetectionConfig& DetectionConfig,
+			const FString& RecordingPath = FString());
+		virtual ~FVisionWorker() override;
+		
+		/**
+		 * Game thread. Hands a frame to the worker, replacing any older one it hasn't started on yet.
+		 * The worker holds on to at most two frames' data: the one it's working on and the next one waiting.
+		 */
+		void PushFrame(const FFramePacket& Frame);
+		
+		/**
+		 * Game thread. Picks up the latest output, if the worker has finished a frame since the last call.
+		 * The returned output stays valid until the next call that returns true.
+		 */
+		const FOutput* TryGetLatestOutput();
+		
+		//~ FRunnable
+		virtual uint32 Run() override;
+		virtual void Stop() override;
+	
+	private:
+		FBlobTracker BlobTracker;
+		int32 NumCalibrationFrames = 0;
+		
+		TTripleBuffer<FFramePacket> InputFrames;
+		TTripleBuffer<FOutput> Outputs;
+		TSharedPtr<const TArray<uint16>> BackgroundDepthMm{};
+		uint32 BackgroundVersion = 0;
+		TUniquePtr<FDepthRecordingWriter> RecordingWriter{};
+		
+		FEvent* FrameReadyEvent = nullptr;
+		FRunnableThread* Thread = nullptr;
+		std::atomic<bool> bStopRequested = false;
+		
+		void ProcessFrame(const FFramePacket& Frame);
+	};
+}
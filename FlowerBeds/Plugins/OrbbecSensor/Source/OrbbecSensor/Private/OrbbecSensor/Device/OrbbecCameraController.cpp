@@ -5,6 +5,7 @@
 #include "Engine/Texture2D.h"
 
 #include "OrbbecSensor/OrbbecSensorModule.h"
+#include "OrbbecSensor/Device/OrbbecFrameBufferPool.h"
 
 // Disable overzealous strncpy warnign
 #if PLATFORM_WINDOWS
@@ -25,7 +26,8 @@ public:
 		const FString& DeviceSerialNumber, 
 		FOrbbecVideoConfig& ColorConfig,
 		FOrbbecVideoConfig& DepthConfig,
-		FOrbbecVideoConfig& IRConfig)
+		FOrbbecVideoConfig& IRConfig,
+		const bool bCopyFrames)
 	{
 		auto Device = PickDevice(DeviceSerialNumber);
 		
@@ -35,6 +37,7 @@ public:
 		}
 		
 		TSharedPtr<FOrbbecImplementation> Implementation{ new FOrbbecImplementation(Device) };
+		Implementation->bCopyFrames = bCopyFrames;
 		
 		if (!Implementation->EnableStreamProfile(EOrbbecSensorType::Color, ColorConfig)) return nullptr;
 		if (!Implementation->EnableStreamProfile(EOrbbecSensorType::Depth, DepthConfig)) return nullptr;
@@ -127,37 +130,55 @@ public:
 			LatestFrameSet.reset();
 		}
 		
-		const auto HandleFrame = [](FOrbbecFrame& Frame, const std::shared_ptr<ob::VideoFrame>& ObFrame)
+		const auto HandleFrame = [this](
+			FOrbbecFrame& Frame, 
+			const std::shared_ptr<ob::VideoFrame>& ObFrame, 
+			FOrbbecFrameBufferPool& BufferPool)
 		{
 			ensure(Frame.Config.Format == MapFormatBack(ObFrame->getFormat()));
 			
 			Frame.TimestampUs = ObFrame->getTimeStampUs();
+			Frame.SystemTimestampUs = ObFrame->getSystemTimeStampUs();
 			
-			const auto DataSize = ObFrame->getDataSize();
-			Frame.Data = MakeShared<TArray<uint8>>();
-			Frame.Data->SetNumUninitialized(DataSize);
-			FMemory::Memcpy(Frame.Data->GetData(), ObFrame->getData(), DataSize);
+			// Drop our reference to the last frame first, so if nobody else is holding it it goes straight back
+			const int32 DataSize = ObFrame->getDataSize();
+			Frame.Data = {};
+			Frame.DataOwner.Reset();
+			
+			if (bCopyFrames)
+			{
+				TSharedPtr<TArray<uint8>> Buffer = BufferPool.Acquire(DataSize);
+				FMemory::Memcpy(Buffer->GetData(), ObFrame->getData(), DataSize);
+				Frame.Data = *Buffer;
+				Frame.DataOwner = MoveTemp(Buffer);
+			}
+			else
+			{
+				// No copy, just keep the SDK's frame alive for as long as anyone's looking at it
+				Frame.Data = TConstArrayView<uint8>(static_cast<const uint8*>(ObFrame->getData()), DataSize);
+				Frame.DataOwner = MakeShared<std::shared_ptr<ob::VideoFrame>>(ObFrame);
+			}
 		};
 		
 		if (ColorFrame.Config.bEnabled)
 		{
 			if (const auto Frame = FrameSet->getColorFrame())
 			{
-				HandleFrame(ColorFrame, Frame);
+				HandleFrame(ColorFrame, Frame, *ColorBufferPool);
 			}
 		}
 		if (DepthFrame.Config.bEnabled)
 		{
 			if (const auto Frame = FrameSet->getDepthFrame())
 			{
-				HandleFrame(DepthFrame, Frame);
+				HandleFrame(DepthFrame, Frame, *DepthBufferPool);
 			}
 		}
 		if (IRFrame.Config.bEnabled)
 		{
 			if (const auto Frame = FrameSet->getIrFrame())
 			{
-				HandleFrame(IRFrame, Frame);
+				HandleFrame(IRFrame, Frame, *IRBufferPool);
 			}
 		}
 		
@@ -171,6 +192,13 @@ private:
 	FCriticalSection LatestFrameSetGuard;
 	std::shared_ptr<ob::FrameSet> LatestFrameSet;
 	
+	bool bCopyFrames = false;
+	
+	// What we copy frames into if bCopyFrames, one pool per stream so each keeps buffers of its own size
+	TSharedRef<FOrbbecFrameBufferPool> ColorBufferPool = FOrbbecFrameBufferPool::Create();
+	TSharedRef<FOrbbecFrameBufferPool> DepthBufferPool = FOrbbecFrameBufferPool::Create();
+	TSharedRef<FOrbbecFrameBufferPool> IRBufferPool = FOrbbecFrameBufferPool::Create();
+	
 	explicit FOrbbecImplementation(std::shared_ptr<ob::Device> Device) : Pipeline(std::move(Device)) {}
 	
 	static std::shared_ptr<ob::Device> PickDevice(const FString& DeviceSerialNumber)
@@ -301,7 +329,8 @@ bool UOrbbecCameraController::StartCamera()
 			CameraConfig.DeviceSerialNumber, 
 			CameraConfig.ColorConfig, 
 			CameraConfig.DepthConfig, 
-			CameraConfig.IRConfig);
+			CameraConfig.IRConfig,
+			CameraConfig.bCopyFrames);
 		
 		if (!Implementation)
 		{
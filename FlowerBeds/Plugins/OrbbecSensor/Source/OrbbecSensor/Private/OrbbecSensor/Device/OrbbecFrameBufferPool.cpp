@@ -0,0 +1,46 @@
+#include "OrbbecSensor/Device/OrbbecFrameBufferPool.h"
+
+#include "OrbbecSensor/OrbbecSensorModule.h"
+
+TSharedRef<FOrbbecFrameBufferPool> FOrbbecFrameBufferPool::Create()
+{
+	return MakeShareable(new FOrbbecFrameBufferPool());
+}
+
+FOrbbecFrameBufferPool::~FOrbbecFrameBufferPool()
+{
+	// Every buffer holds a reference to us, so they're all back by now
+	while (TArray<uint8>* Buffer = FreeBuffers.Pop())
+	{
+		delete Buffer;
+	}
+}
+
+TSharedPtr<TArray<uint8>> FOrbbecFrameBufferPool::Acquire(const int32 NumBytes)
+{
+	TArray<uint8>* Buffer = FreeBuffers.Pop();
+	
+	if (!Buffer)
+	{
+		Buffer = new TArray<uint8>();
+		
+		// Should level off after the first few frames. If it doesn't, something's holding on to them.
+		UE_LOG(LogOrbbecSensor, Verbose, TEXT("Frame buffer pool grew to %d buffers"), ++NumAllocated);
+	}
+	
+	// Only reallocates if the frame size changed
+	if (Buffer->Num() != NumBytes)
+	{
+		Buffer->SetNumUninitialized(NumBytes);
+	}
+	
+	return TSharedPtr<TArray<uint8>>(Buffer, [Pool = AsShared()](TArray<uint8>* InBuffer)
+	{
+		Pool->Release(InBuffer);
+	});
+}
+
+void FOrbbecFrameBufferPool::Release(TArray<uint8>* Buffer)
+{
+	FreeBuffers.Push(Buffer);
+}
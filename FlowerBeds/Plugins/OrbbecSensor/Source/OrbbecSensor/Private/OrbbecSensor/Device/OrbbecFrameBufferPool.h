@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LockFreeList.h"
+
+#include <atomic>
+
+/**
+ * Recycles the buffers frames get copied into, so a stream doesn't allocate and free a whole frame every frame.
+ * Buffers come out as shared pointers whose deleter puts them back on a lock-free free list, whichever thread drops
+ * the last reference. Each buffer holds a reference to the pool, so the pool outlives anything still using one.
+ * One pool per stream: the buffers keep their size, and only get resized if the stream's frame size changes.
+ */
+class FOrbbecFrameBufferPool : public TSharedFromThis<FOrbbecFrameBufferPool>
+{
+public:
+	static TSharedRef<FOrbbecFrameBufferPool> Create();
+	~FOrbbecFrameBufferPool();
+	
+	/**
+	 * A buffer of NumBytes, with unspecified contents. Reuses a free one if there is one, allocating otherwise.
+	 */
+	TSharedPtr<TArray<uint8>> Acquire(int32 NumBytes);
+	
+private:
+	TLockFreePointerListUnordered<TArray<uint8>, PLATFORM_CACHE_LINE_SIZE> FreeBuffers;
+	
+	// How many buffers the pool has allocated over its lifetime. Levels off at however many are in flight at once.
+	std::atomic<int32> NumAllocated = 0;
+	
+	FOrbbecFrameBufferPool() = default;
+	
+	void Release(TArray<uint8>* Buffer);
+};
@@ -97,6 +97,17 @@ struct ORBBECSENSOR_API FOrbbecCameraConfig
 	 */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Config, Category = "Orbbec")
 	FOrbbecVideoConfig IRConfig;
+	
+	/**
+	 * Copy frames out of the SDK into our own pooled buffers, rather than handing out the SDK's. The SDK only has so
+	 * many frames to go round, and without copying each depth frame stays with the SDK until every consumer lets go.
+	 * With the flower beds' blob trackers, that's up to 9 per camera at once: 2 in the controller (the frame set not
+	 * picked up yet and the latest frame), up to 4 in the frame synchronizer, 2 in the vision worker, and 1 in a
+	 * background adapt task, plus up to 4 more waiting to be written out if recording. Only turn this off if the
+	 * SDK's frame pool is comfortably bigger than that.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Config, Category = "Orbbec")
+	bool bCopyFrames = true;
 };
 
 USTRUCT(BlueprintType)
@@ -109,7 +120,13 @@ struct ORBBECSENSOR_API FOrbbecFrame
 	
 	uint64 TimestampUs = 0;
 	
-	TSharedPtr<TArray<uint8>> Data{};
+	// When the frame reached the host, on the host's clock, rather than the device's
+	uint64 SystemTimestampUs = 0;
+	
+	// Points into memory owned by DataOwner: the SDK's frame, or one of our buffers if CameraConfig.bCopyFrames.
+	// Hold on to DataOwner, not just the view, to keep the data around.
+	TConstArrayView<uint8> Data{};
+	TSharedPtr<const void> DataOwner{};
 };
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(
@@ -21,6 +21,31 @@ struct FBlobTrackerConfig
 	
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Config, Category = "BlobTracker")
 	FOrbbecCameraConfig CameraConfig;
+	
+	/**
+	 * If set, record every depth frame the tracker processes to this file. Relative to the Saved directory.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Config, Category = "BlobTracker|Recording")
+	FString RecordingPath;
+	
+	/**
+	 * If set, play back this recording instead of starting the camera. Relative to the Saved directory.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Config, Category = "BlobTracker|Recording")
+	FString ReplayPath;
+	
+	/**
+	 * Play back one frame at a time, only handing over the next once the tracker has finished the last, rather than
+	 * at the pace they were recorded. At the recorded pace the tracker skips frames if it falls behind, as it would
+	 * live, so this is the one to use for reproducible results. Frames are handed over and picked up on the game
+	 * tick, so it goes at most one frame per tick, however fast the tracker is. Frames skip cross-camera syncing,
+	 * so each camera's replay runs at its own pace.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Config, Category = "BlobTracker|Recording")
+	bool bReplayInLockstep = false;
+	
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Config, Category = "BlobTracker|Recording")
+	bool bLoopReplay = true;
 };
 
 UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Blob Tracker Settings"))
@@ -8,13 +8,21 @@
 
 AFlowerBedCoordinator::AFlowerBedCoordinator()
 {
-	PrimaryActorTick.bCanEverTick = false;
+	PrimaryActorTick.bCanEverTick = true;
 }
 
 void AFlowerBedCoordinator::BeginPlay()
 {
 	Super::BeginPlay();
 	
+	TargetFusion.MergeRadiusCm = FusionMergeRadiusCm;
+	TargetFusion.MaxSourceAgeSeconds = MaxCameraSilenceMs / 1000.0f;
+	
+	II::Vision::FFrameSynchronizer::FConfig FrameSyncConfig;
+	FrameSyncConfig.ToleranceUs = static_cast<uint64>(FrameSyncToleranceMs * 1000.0f);
+	FrameSyncConfig.MaxWaitUs = static_cast<uint64>(FrameSyncMaxWaitMs * 1000.0f);
+	FrameSynchronizer.Configure(FrameSyncConfig);
+	
 	CreateBlobTrackersFromSettings();
 	CreateFlowerModulesFromSettings();
 	CreateFlowerControllersFromSettings();
@@ -22,9 +30,51 @@ void AFlowerBedCoordinator::BeginPlay()
 
 void AFlowerBedCoordinator::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+	const FFlowerClusterStore::FCommandStats& CommandStats = FlowerClusterStore.GetCommandStats();
+	UE_LOG(
+		LogFlowerBeds,
+		Display,
+		TEXT("AFlowerBedCoordinator: Sent %llu rotations (%llu settles), held back %llu in the deadband and %llu by the rate limit"),
+		CommandStats.NumSent,
+		CommandStats.NumSettles,
+		CommandStats.NumSuppressedByDeadband,
+		CommandStats.NumSuppressedByRateLimit);
+	
+	TargetFusion.Reset();
+	FrameSynchronizer.Reset();
+	FrameBundle.Frames.Reset();
+	FlowerClusterStore.Reset();
+	
 	Super::EndPlay(EndPlayReason);
 }
 
+void AFlowerBedCoordinator::Tick(const float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+	
+	if (FrameSynchronizer.TryPopBundle(FrameBundle))
+	{
+		for (int32 TrackerIdx = 0; TrackerIdx < FrameBundle.Frames.Num() && TrackerIdx < BlobTrackers.Num(); ++TrackerIdx)
+		{
+			if (!FrameBundle.Frames[TrackerIdx].DepthMm.IsEmpty())
+			{
+				BlobTrackers[TrackerIdx]->PushDepthFrame(FrameBundle.Frames[TrackerIdx]);
+			}
+		}
+		
+		// Done with them, let their buffers go back
+		FrameBundle.Frames.Reset();
+	}
+	
+	if (TargetFusion.Fuse(FPlatformTime::Seconds(), TargetLatencyMs / 1000.0, FusedTargets))
+	{
+		UpdateFlowers();
+	}
+	
+	SendClusterRotations();
+	SyncClusterActors();
+}
+
 void AFlowerBedCoordinator::CreateBlobTrackersFromSettings()
 {
 	const UBlobTrackerSettings* BlobTrackerSettings = GetDefault<UBlobTrackerSettings>();
@@ -50,6 +100,14 @@ void AFlowerBedCoordinator::CreateBlobTrackersFromSettings()
 		
 		SpawnedActor->OnBlobDetectionResult.AddUObject(this, &AFlowerBedCoordinator::OnBlobDetectionResult);
 		
+		if (bSynchronizeCameras)
+		{
+			SpawnedActor->OnDepthFrameCaptured.AddUObject(this, &AFlowerBedCoordinator::OnDepthFrameCaptured);
+		}
+		
+		// Tick after the trackers, so we pick up this tick's frames and detections rather than waiting for the next
+		AddTickPrerequisiteActor(SpawnedActor);
+		
 		BlobTrackers.Add(SpawnedActor);
 	}
 }
@@ -58,26 +116,90 @@ void AFlowerBedCoordinator::OnBlobDetectionResult(
 	const AOrbbecBlobTracker* BlobTracker,
 	const II::Vision::FBlobTracker::FDetectionResult& DetectionResult)
 {
-	TArray<FVector> BlobTargets;
+	// Just hold on to it, Tick fuses whatever's arrived from every camera
+	TargetFusion.SetSourceTracks(
+		BlobTrackers.IndexOfByKey(BlobTracker),
+		BlobTracker->GetActorTransform(),
+		DetectionResult.Tracks,
+		DetectionResult.TimestampUs,
+		FPlatformTime::Seconds());
+}
+
+void AFlowerBedCoordinator::OnDepthFrameCaptured(
+	const AOrbbecBlobTracker* BlobTracker,
+	const II::Vision::FFramePacket& DepthFrame)
+{
+	FrameSynchronizer.PushFrame(BlobTrackers.IndexOfByKey(BlobTracker), DepthFrame);
+}
+
+void AFlowerBedCoordinator::UpdateFlowers()
+{
+	// Each cluster faces whoever's closest
+	TargetGrid.Build(FusedTargets);
+	FlowerClusterStore.AimAtClosest(TargetGrid, FusedTargets);
+}
+
+void AFlowerBedCoordinator::SendClusterRotations()
+{
+	FFlowerClusterStore::FCommandShapingConfig ShapingConfig;
+	ShapingConfig.DeadbandDegrees = RotationDeadbandDegrees;
+	ShapingConfig.MinSendIntervalSeconds = 1.0f / FMath::Max(MaxRotationSendRateHz, 0.1f);
+	ShapingConfig.SettleDelaySeconds = RotationSettleDelayMs / 1000.0f;
+	FlowerClusterStore.ShapeCommands(ShapingConfig, FPlatformTime::Seconds(), ClustersToSend);
 	
-	for (const auto& Blob : DetectionResult.WorldSpaceBlobs)
+	if (ClustersToSend.IsEmpty())
 	{
-		const FVector WorldPos = BlobTracker->GetActorTransform().TransformPosition(Blob.GetWorldPosCm());
-		BlobTargets.Emplace(WorldPos);
+		return;
+	}
+	
+	const TConstArrayView<float> SentYaws = FlowerClusterStore.GetSentYaws();
+	const TConstArrayView<FOSCAddress> OscAddresses = FlowerClusterStore.GetOscAddresses();
+	const TConstArrayView<int32> ControllerIndices = FlowerClusterStore.GetControllerIndices();
+	
+	// Route each rotation to the controller that drives its cluster, then send each controller's lot in one go
+	for (const int32 ClusterIdx : ClustersToSend)
+	{
+		const int32 ControllerIdx = ControllerIndices[ClusterIdx];
+		
+		if (ControllerIdx == INDEX_NONE)
+		{
+			for (UFlowerController* FlowerController : FlowerControllers)
+			{
+				FlowerController->QueueFlowerRotation(OscAddresses[ClusterIdx], SentYaws[ClusterIdx]);
+			}
+		}
+		else if (FlowerControllers.IsValidIndex(ControllerIdx))
+		{
+			FlowerControllers[ControllerIdx]->QueueFlowerRotation(OscAddresses[ClusterIdx], SentYaws[ClusterIdx]);
+		}
 	}
 	
-	TArray<AFlowerCluster::FUpdateTargetResult> UpdateResults;
+	for (UFlowerController* FlowerController : FlowerControllers)
+	{
+		FlowerController->SendQueuedRotations();
+	}
+}
+
+void AFlowerBedCoordinator::SyncClusterActors()
+{
+	const double NowSeconds = FPlatformTime::Seconds();
 	
-	for (const AFlowerModule* FlowerModule : FlowerModules)
+	if (NowSeconds - LastClusterActorSyncSeconds < ClusterActorSyncIntervalMs / 1000.0)
 	{
-		FlowerModule->UpdateClusterTargets(BlobTargets, UpdateResults);
+		return;
 	}
 	
-	for (const AFlowerCluster::FUpdateTargetResult& UpdateResult : UpdateResults)
+	LastClusterActorSyncSeconds = NowSeconds;
+	
+	// Only the ones that have turned, as every move updates the actor's components too
+	const TConstArrayView<float> Yaws = FlowerClusterStore.GetYaws();
+	
+	for (int32 ClusterIdx = 0; ClusterIdx < FlowerClusters.Num(); ++ClusterIdx)
 	{
-		for (UFlowerController* FlowerController : FlowerControllers)
+		if (Yaws[ClusterIdx] != SyncedClusterYaws[ClusterIdx])
 		{
-			FlowerController->SendFlowerRotation(UpdateResult.OscAddress, UpdateResult.Rotation);
+			SyncedClusterYaws[ClusterIdx] = Yaws[ClusterIdx];
+			FlowerClusters[ClusterIdx]->SetActorRotation(FRotator(0.0, Yaws[ClusterIdx], 0.0));
 		}
 	}
 }
@@ -103,6 +225,18 @@ void AFlowerBedCoordinator::CreateFlowerModulesFromSettings()
 			SpawnParams);
 		SpawnedActor->Init(FlowerModuleConfig);
 		FlowerModules.Add(SpawnedActor);
+		
+		for (AFlowerCluster* FlowerCluster : SpawnedActor->GetFlowerClusters())
+		{
+			FlowerClusters.Add(FlowerCluster);
+			const float Yaw = FlowerCluster->GetActorRotation().Yaw;
+			FlowerClusterStore.Add(
+				FlowerCluster->GetActorLocation(),
+				Yaw,
+				FlowerCluster->OscAddress,
+				FlowerCluster->ControllerIdx);
+			SyncedClusterYaws.Add(Yaw);
+		}
 	}
 }
 
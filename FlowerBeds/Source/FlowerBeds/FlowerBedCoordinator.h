@@ -1,12 +1,16 @@
 ﻿#pragma once
 
 #include "CoreMinimal.h"
+#include "FlowerCluster.h"
+#include "FlowerClusterStore.h"
 #include "OrbbecToVisionHelpers.h"
 #include "IIVision/BlobTracker.h"
+#include "IIVision/FrameSynchronizer.h"
+#include "TargetFusion.h"
+#include "TargetGrid.h"
 
 #include "FlowerBedCoordinator.generated.h"
 
-class AFlowerCluster;
 class UFlowerController;
 class AFlowerModule;
 class AOrbbecBlobTracker;
@@ -23,10 +27,74 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds")
 	TSubclassOf<AFlowerModule> FlowerModuleClass;
 	
+	/**
+	 * How long after a frame is captured the flowers actually get there: the vision pipeline, the network and the
+	 * servos. Flowers aim at where each visitor is predicted to be this far ahead of the frame.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds", meta = (ClampMin = 0, Units = "ms"))
+	float TargetLatencyMs = 150.0f;
+	
+	/**
+	 * Where cameras overlap, people they see closer together than this are taken to be the same person.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds", meta = (ClampMin = 0, Units = "cm"))
+	float FusionMergeRadiusCm = 60.0f;
+	
+	/**
+	 * A camera that hasn't sent anything for this long is left out, rather than its last people staying around.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds", meta = (ClampMin = 0, Units = "ms"))
+	float MaxCameraSilenceMs = 250.0f;
+	
+	/**
+	 * Line up frames from all the cameras before detection, so every camera's people are from the same moment.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds|Frame Sync")
+	bool bSynchronizeCameras = true;
+	
+	/**
+	 * Frames from different cameras this close together count as the same moment. About half a frame.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds|Frame Sync", meta = (ClampMin = 0, Units = "ms"))
+	float FrameSyncToleranceMs = 20.0f;
+	
+	/**
+	 * How far a camera can fall behind the others before we stop waiting for it, and go on without it.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds|Frame Sync", meta = (ClampMin = 0, Units = "ms"))
+	float FrameSyncMaxWaitMs = 50.0f;
+	
+	/**
+	 * How often the flower cluster actors are turned to match where the flowers are aiming. They're only there to
+	 * look at, so there's no need to move them every update.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds", meta = (ClampMin = 0, Units = "ms"))
+	float ClusterActorSyncIntervalMs = 100.0f;
+	
+	/**
+	 * Flowers don't get sent moves smaller than this, until they've held still for RotationSettleDelayMs.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds|Servos", meta = (ClampMin = 0, Units = "deg"))
+	float RotationDeadbandDegrees = 1.0f;
+	
+	/**
+	 * The most often any one flower gets sent a rotation.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds|Servos", meta = (ClampMin = 0.1, Units = "Hz"))
+	float MaxRotationSendRateHz = 10.0f;
+	
+	/**
+	 * Once a flower's target has held still this long, it gets sent its exact rotation, if that's not what it was
+	 * last sent.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds|Servos", meta = (ClampMin = 0, Units = "ms"))
+	float RotationSettleDelayMs = 300.0f;
+	
 	AFlowerBedCoordinator();
 	
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
 	
 private:
 	UPROPERTY(Transient)
@@ -37,11 +105,40 @@ private:
 		const AOrbbecBlobTracker* BlobTracker, 
 		const II::Vision::FBlobTracker::FDetectionResult& DetectionResult);
 	
+	II::Vision::FFrameSynchronizer FrameSynchronizer;
+	II::Vision::FFrameSynchronizer::FBundle FrameBundle;
+	
+	void OnDepthFrameCaptured(const AOrbbecBlobTracker* BlobTracker, const II::Vision::FFramePacket& DepthFrame);
+	
+	// Every camera's people merged into one list, once per tick rather than once per camera
+	FTargetFusion TargetFusion;
+	TArray<FVector> FusedTargets;
+	
+	void UpdateFlowers();
+	
 	UPROPERTY(Transient)
 	TArray<TObjectPtr<AFlowerModule>> FlowerModules;
 	
 	void CreateFlowerModulesFromSettings();
 	
+	// Every module's clusters in one list. Their state lives in FlowerClusterStore, by the same index.
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<AFlowerCluster>> FlowerClusters;
+	
+	FFlowerClusterStore FlowerClusterStore;
+	FTargetGrid TargetGrid;
+	
+	// The yaws we last turned the actors to, and when
+	TArray<float> SyncedClusterYaws;
+	double LastClusterActorSyncSeconds = 0.0;
+	
+	void SyncClusterActors();
+	
+	// Scratch for which clusters' rotations go out this tick
+	TArray<int32> ClustersToSend;
+	
+	void SendClusterRotations();
+	
 	UPROPERTY(Transient)
 	TArray<TObjectPtr<UFlowerController>> FlowerControllers;
 	
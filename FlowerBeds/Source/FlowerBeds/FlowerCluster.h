@@ -27,6 +27,13 @@ struct FFlowerClusterConfig
 	 */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Config, Category = "Flower Beds")
 	FString OscAddress = "";
+	
+	/**
+	 * Which of the flower controllers drives this cluster, as an index into the flower bed settings' controllers.
+	 * -1 sends its updates to every controller.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Config, Category = "Flower Beds", meta = (ClampMin = -1))
+	int32 ControllerIdx = INDEX_NONE;
 };
 
 UCLASS(ClassGroup = (FlowerBeds))
@@ -38,15 +45,9 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds")
 	FOSCAddress OscAddress;
 	
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flower Beds")
+	int32 ControllerIdx = INDEX_NONE;
+	
 	UFUNCTION(BlueprintCallable)
 	void Init(const FFlowerClusterConfig& Config);
-	
-	struct FUpdateTargetResult
-	{
-		bool HasTarget = false;
-		FOSCAddress OscAddress;
-		float Rotation;
-	};
-	
-	FUpdateTargetResult UpdateClusterTargets(const TArray<FVector>& Targets);
 };
@@ -0,0 +1,148 @@
+﻿#include "FlowerClusterStore.h"
+
+#include "TargetGrid.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	// Below this many clusters, aiming them is quicker than farming the work out
+	constexpr int32 MinClustersPerTask = 128;
+	
+	// Yaw changes smaller than this fraction of the deadband don't restart the settle delay, or a cluster facing
+	// someone standing still would never settle for the jitter in their position
+	constexpr float SettleToleranceFraction = 0.25f;
+}
+
+void FFlowerClusterStore::Add(
+	const FVector& Location,
+	const float Yaw,
+	const FOSCAddress& OscAddress,
+	const int32 ControllerIdx)
+{
+	Locations.Add(Location);
+	OscAddresses.Add(OscAddress);
+	ControllerIndices.Add(ControllerIdx);
+	Yaws.Add(Yaw);
+	YawsChanged.Add(false);
+	SettleYaws.Add(Yaw);
+	LastYawChangeSeconds.Add(0.0);
+	SettlesSent.Add(false);
+	
+	// Where the actor was placed, so nothing's sent until there's someone to face
+	SentYaws.Add(Yaw);
+	LastSentSeconds.Add(0.0);
+}
+
+void FFlowerClusterStore::Reset()
+{
+	Locations.Reset();
+	OscAddresses.Reset();
+	ControllerIndices.Reset();
+	Yaws.Reset();
+	YawsChanged.Reset();
+	SettleYaws.Reset();
+	LastYawChangeSeconds.Reset();
+	SettlesSent.Reset();
+	SentYaws.Reset();
+	LastSentSeconds.Reset();
+	CommandStats = {};
+}
+
+void FFlowerClusterStore::AimAtClosest(
+	const FTargetGrid& TargetGrid,
+	const TConstArrayView<FVector> Targets)
+{
+	const int32 NumClusters = Num();
+	const int32 NumTasks = FMath::DivideAndRoundUp(NumClusters, MinClustersPerTask);
+	
+	ParallelFor(NumTasks, [this, &TargetGrid, Targets, NumClusters](const int32 TaskIdx)
+	{
+		const int32 EndIdx = FMath::Min((TaskIdx + 1) * MinClustersPerTask, NumClusters);
+		
+		for (int32 ClusterIdx = TaskIdx * MinClustersPerTask; ClusterIdx < EndIdx; ++ClusterIdx)
+		{
+			const int32 TargetIdx = TargetGrid.FindClosest(Locations[ClusterIdx]);
+			
+			if (TargetIdx == INDEX_NONE)
+			{
+				continue;
+			}
+			
+			// Flowers only turn about the vertical, so it's just the heading across the ground
+			const FVector ToTarget = Targets[TargetIdx] - Locations[ClusterIdx];
+			
+			if (FMath::IsNearlyZero(ToTarget.X) && FMath::IsNearlyZero(ToTarget.Y))
+			{
+				continue;
+			}
+			
+			const float Yaw = FMath::RadiansToDegrees(FMath::Atan2(ToTarget.Y, ToTarget.X));
+			
+			if (Yaw != Yaws[ClusterIdx])
+			{
+				Yaws[ClusterIdx] = Yaw;
+				YawsChanged[ClusterIdx] = true;
+			}
+		}
+	}, NumTasks <= 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void FFlowerClusterStore::ShapeCommands(
+	const FCommandShapingConfig& Config,
+	const double NowSeconds,
+	TArray<int32>& OutClusterIndices)
+{
+	OutClusterIndices.Reset();
+	
+	for (int32 ClusterIdx = 0; ClusterIdx < Num(); ++ClusterIdx)
+	{
+		const bool bYawChanged = YawsChanged[ClusterIdx];
+		YawsChanged[ClusterIdx] = false;
+		
+		// Only moves past the tolerance restart the settle delay
+		if (bYawChanged)
+		{
+			const float SettleDeltaDegrees = FMath::Abs(FMath::FindDeltaAngleDegrees(SettleYaws[ClusterIdx], Yaws[ClusterIdx]));
+			
+			if (SettleDeltaDegrees > Config.DeadbandDegrees * SettleToleranceFraction)
+			{
+				SettleYaws[ClusterIdx] = Yaws[ClusterIdx];
+				LastYawChangeSeconds[ClusterIdx] = NowSeconds;
+				SettlesSent[ClusterIdx] = false;
+			}
+		}
+		
+		// Already there
+		if (Yaws[ClusterIdx] == SentYaws[ClusterIdx])
+		{
+			continue;
+		}
+		
+		const float DeltaDegrees = FMath::Abs(FMath::FindDeltaAngleDegrees(SentYaws[ClusterIdx], Yaws[ClusterIdx]));
+		const bool bOutsideDeadband = DeltaDegrees > Config.DeadbandDegrees;
+		const bool bRateLimited = NowSeconds - LastSentSeconds[ClusterIdx] < Config.MinSendIntervalSeconds;
+		
+		// One settle per spell of holding still, to where it settled rather than wherever the jitter has it now
+		const bool bSettleDue = !SettlesSent[ClusterIdx] &&
+			NowSeconds - LastYawChangeSeconds[ClusterIdx] >= Config.SettleDelaySeconds &&
+			SettleYaws[ClusterIdx] != SentYaws[ClusterIdx];
+		
+		if ((bOutsideDeadband || bSettleDue) && !bRateLimited)
+		{
+			OutClusterIndices.Add(ClusterIdx);
+			SentYaws[ClusterIdx] = bOutsideDeadband ? Yaws[ClusterIdx] : SettleYaws[ClusterIdx];
+			LastSentSeconds[ClusterIdx] = NowSeconds;
+			SettlesSent[ClusterIdx] |= !bOutsideDeadband;
+			++CommandStats.NumSent;
+			CommandStats.NumSettles += !bOutsideDeadband;
+		}
+		else if (bYawChanged && bRateLimited)
+		{
+			++CommandStats.NumSuppressedByRateLimit;
+		}
+		else if (bYawChanged)
+		{
+			++CommandStats.NumSuppressedByDeadband;
+		}
+	}
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "OSCAddress.h"
+
+class FTargetGrid;
+
+/**
+ * Every flower cluster's state, one array per field, so aiming them all is one pass over flat arrays rather than a
+ * round of actor calls each. The cluster actors are only there to be looked at, and get synced from here.
+ */
+class FFlowerClusterStore
+{
+public:
+	// Keeps the servos from being sent every little twitch of the yaw
+	struct FCommandShapingConfig
+	{
+		// Moves smaller than this aren't sent straight away
+		float DeadbandDegrees = 1.0f;
+		
+		// No cluster is sent more often than this
+		float MinSendIntervalSeconds = 0.1f;
+		
+		// Once a cluster's yaw has held still this long, the yaw it settled at is sent if that's not what was last
+		// sent, so the flower ends up where it should rather than within the deadband of it. Jitter of under a
+		// quarter of the deadband counts as holding still, and only gets one settle until the yaw moves on again.
+		float SettleDelaySeconds = 0.3f;
+	};
+	
+	struct FCommandStats
+	{
+		uint64 NumSent = 0;
+		
+		// Of NumSent, the final sends once a cluster held still
+		uint64 NumSettles = 0;
+		
+		// New yaws not sent, because they were within the deadband of the last one sent, or came too soon after it
+		uint64 NumSuppressedByDeadband = 0;
+		uint64 NumSuppressedByRateLimit = 0;
+	};
+	
+	void Add(const FVector& Location, float Yaw, const FOSCAddress& OscAddress, int32 ControllerIdx);
+	void Reset();
+	
+	int32 Num() const { return Locations.Num(); }
+	
+	/**
+	 * Turns every cluster to face its closest target, in parallel. Clusters keep their last yaw if there are no
+	 * targets at all.
+	 */
+	void AimAtClosest(const FTargetGrid& TargetGrid, TConstArrayView<FVector> Targets);
+	
+	/**
+	 * Picks out the clusters whose yaw should be sent to the servos now, and takes them as sent. Call every tick, not
+	 * just when yaws change, as held back moves and settles come due in between.
+	 */
+	void ShapeCommands(const FCommandShapingConfig& Config, double NowSeconds, TArray<int32>& OutClusterIndices);
+	
+	const FCommandStats& GetCommandStats() const { return CommandStats; }
+	
+	// Fixed once added
+	TConstArrayView<FOSCAddress> GetOscAddresses() const { return OscAddresses; }
+	TConstArrayView<int32> GetControllerIndices() const { return ControllerIndices; }
+	
+	// In degrees, as of the last AimAtClosest
+	TConstArrayView<float> GetYaws() const { return Yaws; }
+	
+	// In degrees, what each cluster was last sent. For the clusters ShapeCommands picks out, what to send them.
+	TConstArrayView<float> GetSentYaws() const { return SentYaws; }
+
+private:
+	TArray<FVector> Locations;
+	TArray<FOSCAddress> OscAddresses;
+	TArray<int32> ControllerIndices;
+	TArray<float> Yaws;
+	
+	// Set when the yaw changes, until ShapeCommands has looked at it
+	TArray<bool> YawsChanged;
+	
+	// The yaw as of the last move big enough to restart the settle delay, and when that was
+	TArray<float> SettleYaws;
+	TArray<double> LastYawChangeSeconds;
+	
+	// Set once the settle's been sent, until the settle delay restarts
+	TArray<bool> SettlesSent;
+	
+	TArray<float> SentYaws;
+	TArray<double> LastSentSeconds;
+	
+	FCommandStats CommandStats{};
+};
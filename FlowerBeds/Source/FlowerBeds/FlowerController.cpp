@@ -3,6 +3,27 @@
 #include "OSCClient.h"
 #include "OSCManager.h"
 
+namespace
+{
+	// What the controller firmware reads each datagram into. Anything longer gets cut off.
+	constexpr int32 MaxDatagramBytes = 512;
+	
+	// "#bundle" and the time tag
+	constexpr int32 BundleHeaderBytes = 16;
+	
+	// OSC pads strings with at least one null, out to a multiple of 4 bytes
+	int32 GetOscStringBytes(const FString& String)
+	{
+		return Align(FTCHARToUTF8(*String).Length() + 1, 4);
+	}
+	
+	// As a bundle element: its size, the address, the ",f" type tag and the float
+	int32 GetRotationMessageBytes(const FOSCAddress& Address)
+	{
+		return 4 + GetOscStringBytes(Address.GetFullPath()) + 4 + 4;
+	}
+}
+
 void UFlowerController::Init(const FFlowerControllerConfig& Config)
 {
 	OscClient = UOSCManager::CreateOSCClient(
@@ -18,3 +39,43 @@ void UFlowerController::SendFlowerRotation(const FOSCAddress& Address, float Rot
 	FOSCMessage Message(Address, { RotationData });
 	OscClient->SendOSCMessage(Message);
 }
+
+void UFlowerController::QueueFlowerRotation(const FOSCAddress& Address, const float Rotation)
+{
+	QueuedRotations.Add({ Address, Rotation });
+}
+
+void UFlowerController::SendQueuedRotations()
+{
+	if (QueuedRotations.IsEmpty() || !OscClient)
+	{
+		QueuedRotations.Reset();
+		return;
+	}
+	
+	FOSCBundle Bundle;
+	int32 BundleBytes = BundleHeaderBytes;
+	int32 NumInBundle = 0;
+	
+	for (const FQueuedRotation& Queued : QueuedRotations)
+	{
+		const int32 MessageBytes = GetRotationMessageBytes(Queued.Address);
+		
+		// Full, so send what we have and start another
+		if (NumInBundle && BundleBytes + MessageBytes > MaxDatagramBytes)
+		{
+			OscClient->SendOSCBundle(Bundle);
+			Bundle = FOSCBundle();
+			BundleBytes = BundleHeaderBytes;
+			NumInBundle = 0;
+		}
+		
+		UE::OSC::FOSCData RotationData(Queued.Rotation);
+		UOSCManager::AddMessageToBundle(FOSCMessage(Queued.Address, { RotationData }), Bundle);
+		BundleBytes += MessageBytes;
+		++NumInBundle;
+	}
+	
+	OscClient->SendOSCBundle(Bundle);
+	QueuedRotations.Reset();
+}
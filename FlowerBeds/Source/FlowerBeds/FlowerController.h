@@ -37,7 +37,24 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void SendFlowerRotation(const FOSCAddress& Address, float Rotation) const;
 	
+	// Holds a rotation back to go out with the rest in SendQueuedRotations
+	void QueueFlowerRotation(const FOSCAddress& Address, float Rotation);
+	
+	/**
+	 * Sends everything queued as OSC bundles, as few as fit the controller's 512 byte receive buffer, so a tick's
+	 * updates are a datagram or two rather than one per cluster.
+	 */
+	void SendQueuedRotations();
+	
 private:
 	UPROPERTY(Transient)
 	TObjectPtr<UOSCClient> OscClient;
+	
+	struct FQueuedRotation
+	{
+		FOSCAddress Address;
+		float Rotation = 0.0f;
+	};
+	
+	TArray<FQueuedRotation> QueuedRotations;
 };
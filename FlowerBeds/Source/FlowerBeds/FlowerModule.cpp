@@ -19,13 +19,3 @@ void AFlowerModule::Init(const FFlowerModuleConfig& Config)
 		FlowerClusters.Add(SpawnedActor);
 	}
 }
-
-void AFlowerModule::UpdateClusterTargets(
-	const TArray<FVector>& Targets,
-	TArray<AFlowerCluster::FUpdateTargetResult>& Results) const
-{
-	for (const auto& Cluster : FlowerClusters)
-	{
-		Results.Add(Cluster->UpdateClusterTargets(Targets));
-	}
-}
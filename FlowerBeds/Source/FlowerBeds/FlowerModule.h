@@ -41,7 +41,7 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void Init(const FFlowerModuleConfig& Config);
 	
-	void UpdateClusterTargets(const TArray<FVector>& Targets, TArray<AFlowerCluster::FUpdateTargetResult>& Results) const;
+	const TArray<TObjectPtr<AFlowerCluster>>& GetFlowerClusters() const { return FlowerClusters; }
 	
 private:
 	UPROPERTY(Transient)
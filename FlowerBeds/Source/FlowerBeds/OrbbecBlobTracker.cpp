@@ -5,11 +5,29 @@
 #include "FlowerBeds/FlowerBeds.h"
 #include "FlowerBeds/OrbbecToVisionHelpers.h"
 #include "IIVision/BlobArrayVisualizer.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
 #include "OrbbecSensor/Device/OrbbecCameraController.h"
 
+namespace
+{
+	FString ResolveRecordingPath(const FString& Path)
+	{
+		return FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir(), Path);
+	}
+	
+	// Microseconds since the Unix epoch, as the camera SDK stamps frames with when they reach us
+	uint64 GetSystemTimestampUs()
+	{
+		return (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTicks() / ETimespan::TicksPerMicrosecond;
+	}
+}
+
 AOrbbecBlobTracker::AOrbbecBlobTracker()
 {
 	CameraController = CreateDefaultSubobject<UOrbbecCameraController>("CameraController");
+	
+	PrimaryActorTick.bCanEverTick = true;
 }
 
 void AOrbbecBlobTracker::BeginPlay()
@@ -25,11 +43,13 @@ void AOrbbecBlobTracker::BeginPlay()
 		return;
 	}
 	
-	if (const FBlobTrackerConfig* FoundConfig = BlobTrackerSettings->BlobTrackers.FindByPredicate(
+	const FBlobTrackerConfig* FoundConfig = BlobTrackerSettings->BlobTrackers.FindByPredicate(
 		[Name = BlobTrackerName](const FBlobTrackerConfig& Config)
 		{
 			return Config.Name == Name;
-		}))
+		});
+	
+	if (FoundConfig)
 	{
 		// Set position
 		SetActorLocation(FoundConfig->PosCm);
@@ -39,6 +59,20 @@ void AOrbbecBlobTracker::BeginPlay()
 		CameraController->CameraConfig = FoundConfig->CameraConfig;
 	}
 	
+	VisionWorker = MakeUnique<II::Vision::FVisionWorker>(
+		FString::Printf(TEXT("VisionWorker_%s"), *BlobTrackerName.ToString()),
+		60,
+		II::Vision::FBlobTracker::FDetectionConfig{},
+		FoundConfig && !FoundConfig->RecordingPath.IsEmpty() ? ResolveRecordingPath(FoundConfig->RecordingPath) : FString());
+	
+	if (FoundConfig && !FoundConfig->ReplayPath.IsEmpty())
+	{
+		bReplayInLockstep = FoundConfig->bReplayInLockstep;
+		bLoopReplay = FoundConfig->bLoopReplay;
+		StartReplay(ResolveRecordingPath(FoundConfig->ReplayPath));
+		return;
+	}
+	
 	check(CameraController);
 	OnFramesReceivedDelegateHandle = 
 		CameraController->OnFramesReceivedNative.AddUObject(this, &AOrbbecBlobTracker::OnFramesReceived);
@@ -52,77 +86,207 @@ void AOrbbecBlobTracker::EndPlay(const EEndPlayReason::Type EndPlayReason)
 		CameraController->OnFramesReceivedNative.Remove(OnFramesReceivedDelegateHandle);
 	}
 	
+	// Blocks until the worker is done with the frame it's on
+	VisionWorker.Reset();
+	ReplayReader.Reset();
+	
 	Super::EndPlay(EndPlayReason);
 }
 
+void AOrbbecBlobTracker::Tick(const float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+	
+	if (!VisionWorker)
+	{
+		return;
+	}
+	
+	if (const II::Vision::FVisionWorker::FOutput* Output = VisionWorker->TryGetLatestOutput())
+	{
+		bReplayFrameInFlight = false;
+		OnVisionOutput(*Output);
+	}
+	
+	TickReplay();
+}
+
+void AOrbbecBlobTracker::StartReplay(const FString& Path)
+{
+	ReplayReader = II::Vision::FDepthRecordingReader::Open(Path);
+	
+	if (!ReplayReader)
+	{
+		return;
+	}
+	
+	UE_LOG(LogFlowerBeds, Display, TEXT("Blob tracker %s replaying '%s'"), *BlobTrackerName.ToString(), *Path);
+	
+	bHasNextReplayFrame = ReadReplayFrame();
+	ReplayStartSeconds = FPlatformTime::Seconds();
+	ReplayStartTimestampUs = NextReplayFrame.TimestampUs;
+}
+
+void AOrbbecBlobTracker::TickReplay()
+{
+	if (!ReplayReader || !bHasNextReplayFrame)
+	{
+		return;
+	}
+	
+	if (bReplayInLockstep)
+	{
+		// Only hand over the next frame once the worker has finished the last one, so it sees every frame. Straight
+		// to the worker, past OnDepthFrameCaptured: the synchronizer may drop a frame it can't pair up, and then we'd
+		// wait on it forever.
+		if (!bReplayFrameInFlight)
+		{
+			NextReplayFrame.SystemTimestampUs = GetSystemTimestampUs();
+			PushDepthFrame(NextReplayFrame);
+			bReplayFrameInFlight = true;
+			bHasNextReplayFrame = ReadReplayFrame();
+		}
+		
+		return;
+	}
+	
+	// Hand over whatever has come due since last tick. If that's several, the worker only keeps the newest, as live.
+	const double ReplayUs = (FPlatformTime::Seconds() - ReplayStartSeconds) * 1e6;
+	
+	while (bHasNextReplayFrame && static_cast<double>(NextReplayFrame.TimestampUs - ReplayStartTimestampUs) <= ReplayUs)
+	{
+		NextReplayFrame.SystemTimestampUs = GetSystemTimestampUs();
+		OnDepthFrame(NextReplayFrame);
+		bHasNextReplayFrame = ReadReplayFrame();
+	}
+}
+
+bool AOrbbecBlobTracker::ReadReplayFrame()
+{
+	if (ReplayReader->ReadFrame(NextReplayFrame))
+	{
+		return true;
+	}
+	
+	if (!bLoopReplay)
+	{
+		UE_LOG(LogFlowerBeds, Display, TEXT("Blob tracker %s reached the end of its replay"), *BlobTrackerName.ToString());
+		return false;
+	}
+	
+	ReplayReader->Rewind();
+	
+	if (!ReplayReader->ReadFrame(NextReplayFrame))
+	{
+		return false;
+	}
+	
+	// Recorded time starts over, so pacing does too
+	ReplayStartSeconds = FPlatformTime::Seconds();
+	ReplayStartTimestampUs = NextReplayFrame.TimestampUs;
+	return true;
+}
+
 void AOrbbecBlobTracker::OnFramesReceived(
 	const FOrbbecFrame& /* ColorFrame */, 
 	const FOrbbecFrame& DepthFrame, 
 	const FOrbbecFrame& /* IRFrame */)
+{
+	OnDepthFrame(II::Util::OrbbecToVisionFrame(DepthFrame));
+}
+
+void AOrbbecBlobTracker::OnDepthFrame(const II::Vision::FFramePacket& DepthFrame)
+{
+	if (OnDepthFrameCaptured.IsBound())
+	{
+		OnDepthFrameCaptured.Broadcast(this, DepthFrame);
+		return;
+	}
+	
+	PushDepthFrame(DepthFrame);
+}
+
+void AOrbbecBlobTracker::PushDepthFrame(const II::Vision::FFramePacket& DepthFrame)
 {
 	if (DepthFeedVisualizer)
 	{
-		DepthFeedVisualizer->InitTexture(DepthFrame.Config.Width, DepthFrame.Config.Height, PF_G16, false);
-		DepthFeedVisualizer->UpdateTexture(DepthFrame.Data->GetData(), DepthFrame.Config.Width, DepthFrame.Config.Height, PF_G16);
+		DepthFeedVisualizer->InitTexture(DepthFrame.Width, DepthFrame.Height, PF_G16, false);
+		DepthFeedVisualizer->UpdateTexture(
+			reinterpret_cast<const uint8*>(DepthFrame.DepthMm.GetData()), 
+			DepthFrame.Width, 
+			DepthFrame.Height, 
+			PF_G16);
 	}
 	
-	switch (BlobTracker.GetCalibrationState())
+	if (VisionWorker)
 	{
-	case II::Vision::FBlobTracker::ECalibrationState::NotCalibrated:
-		BlobTracker.BeginCalibration(60, DepthFrame.Config.Width, DepthFrame.Config.Height);
-		BlobTracker.PushCalibrationFrame(II::Util::OrbbecToVisionFrame(DepthFrame));
-		break;
-	case II::Vision::FBlobTracker::ECalibrationState::CalibrationInProgress:
-		BlobTracker.PushCalibrationFrame(II::Util::OrbbecToVisionFrame(DepthFrame));
-		
-		// If we just completed calibration, update the background depth map
-		if (BlobTracker.GetCalibrationState() == II::Vision::FBlobTracker::ECalibrationState::Calibrated)
-		{
-			if (BlobBgVisualizer)
-			{
-				BlobBgVisualizer->InitTexture(BlobTracker.GetWidth(), BlobTracker.GetHeight(), PF_G16, false);
-				BlobBgVisualizer->UpdateTexture(
-					reinterpret_cast<const uint8*>(BlobTracker.GetBackgroundDepthMm().GetData()), 
-					BlobTracker.GetWidth(), 
-					BlobTracker.GetHeight(), 
-					PF_G16);
-			}
-		}
-		break;
-	case II::Vision::FBlobTracker::ECalibrationState::Calibrated:
-		II::Vision::FBlobTracker::FDetectionResult DetectionResult;
-		BlobTracker.Detect(II::Util::OrbbecToVisionFrame(DepthFrame), DetectionResult);
-		
-		OnBlobDetectionResult.Broadcast(this, DetectionResult);
-		
-		if (BlobFgVisualizer)
-		{
-			BlobFgVisualizer->InitTexture(BlobTracker.GetWidth(), BlobTracker.GetHeight(), PF_G8, false);
-			BlobFgVisualizer->UpdateTexture(DetectionResult.Foreground.GetData(), BlobTracker.GetWidth(), BlobTracker.GetHeight(), PF_G8);
-		}
+		VisionWorker->PushFrame(DepthFrame);
+	}
+}
+
+void AOrbbecBlobTracker::OnVisionOutput(const II::Vision::FVisionWorker::FOutput& Output)
+{
+	// Calibration finished or the background adapted, so update the background depth map
+	if (Output.BackgroundDepthMm && Output.BackgroundDepthMm != VisualizedBackgroundDepthMm)
+	{
+		VisualizedBackgroundDepthMm = Output.BackgroundDepthMm;
 		
-		if (BlobVisualizer)
+		if (BlobBgVisualizer)
 		{
-			BlobVisualizer->InitTexture(BlobTracker.GetWidth(), BlobTracker.GetHeight());
-			BlobVisualizer->UpdateTexture(DetectionResult.ScreenSpaceBlobs);
+			BlobBgVisualizer->InitTexture(Output.Width, Output.Height, PF_G16, false);
+			BlobBgVisualizer->UpdateTexture(
+				reinterpret_cast<const uint8*>(Output.BackgroundDepthMm->GetData()), 
+				Output.Width, 
+				Output.Height, 
+				PF_G16);
 		}
-		
-		UpdateWorldBlobs(DetectionResult.WorldSpaceBlobs);
-		
-		break;
 	}
+	
+	if (Output.CalibrationState != II::Vision::FBlobTracker::ECalibrationState::Calibrated)
+	{
+		return;
+	}
+	
+	const II::Vision::FBlobTracker::FDetectionResult& DetectionResult = Output.DetectionResult;
+	
+	OnBlobDetectionResult.Broadcast(this, DetectionResult);
+	
+	if (BlobFgVisualizer)
+	{
+		BlobFgVisualizer->InitTexture(Output.Width, Output.Height, PF_G8, false);
+		BlobFgVisualizer->UpdateTexture(DetectionResult.Foreground.GetData(), Output.Width, Output.Height, PF_G8);
+	}
+	
+	if (BlobVisualizer)
+	{
+		BlobVisualizer->InitTexture(Output.Width, Output.Height);
+		BlobVisualizer->UpdateTexture(DetectionResult.ScreenSpaceBlobs);
+	}
+	
+	UpdateWorldBlobs(DetectionResult.Tracks);
 }
 
-void AOrbbecBlobTracker::UpdateWorldBlobs(const TArray<II::Vision::FBlobTracker::FBlob3D>& Blobs)
+void AOrbbecBlobTracker::UpdateWorldBlobs(const TArray<II::Vision::FBlobTracker::FTrack>& Tracks)
 {
-	int32 BlobIdx = 0;
+	// Free up the actors of tracks that have died
+	for (auto It = TrackBlobActors.CreateIterator(); It; ++It)
+	{
+		const int32 TrackId = It.Key();
+		
+		if (!Tracks.ContainsByPredicate([TrackId](const auto& Track) { return Track.Id == TrackId; }))
+		{
+			BlobActors[It.Value()]->SetActorHiddenInGame(true);
+			FreeBlobActors.Add(It.Value());
+			It.RemoveCurrent();
+		}
+	}
 	
-	for (const auto& Blob : Blobs)
+	for (const auto& Track : Tracks)
 	{
 		// Transform to world space
 		const FTransform WorldTransform = GetActorTransform();
-		const FVector WorldPos = WorldTransform.TransformPosition(Blob.GetWorldPosCm());
-		const FVector WorldHalfExtents = WorldTransform.TransformVector(Blob.GetWorldHalfExtentsCm());
+		const FVector WorldPos = WorldTransform.TransformPosition(Track.Blob.GetWorldPosCm());
+		const FVector WorldHalfExtents = WorldTransform.TransformVector(Track.Blob.GetWorldHalfExtentsCm());
 		
 		DrawBlobDebug(WorldPos, WorldHalfExtents);
 		
@@ -131,28 +295,26 @@ void AOrbbecBlobTracker::UpdateWorldBlobs(const TArray<II::Vision::FBlobTracker:
 			continue;
 		}
 		
-		if (BlobIdx < BlobActors.Num())
+		if (const int32* BlobActorIdx = TrackBlobActors.Find(Track.Id))
+		{
+			BlobActors[*BlobActorIdx]->SetActorLocation(WorldPos);
+		}
+		else if (!FreeBlobActors.IsEmpty())
 		{
-			BlobActors[BlobIdx]->SetActorHiddenInGame(false);
-			BlobActors[BlobIdx]->SetActorLocation(WorldPos);
+			const int32 FreeIdx = FreeBlobActors.Pop();
+			BlobActors[FreeIdx]->SetActorHiddenInGame(false);
+			BlobActors[FreeIdx]->SetActorLocation(WorldPos);
+			TrackBlobActors.Add(Track.Id, FreeIdx);
 		}
 		else
 		{
 			FActorSpawnParameters SpawnParams;
 			SpawnParams.Owner = this;
-			BlobActors.Emplace(
-				GetWorld()->SpawnActor<AActor>(BlobActorClass, WorldPos, FRotator::ZeroRotator, SpawnParams));
+			TrackBlobActors.Add(Track.Id, BlobActors.Emplace(
+				GetWorld()->SpawnActor<AActor>(BlobActorClass, WorldPos, FRotator::ZeroRotator, SpawnParams)));
 			
 			OnBlobActorSpawned.Broadcast(BlobActors.Last());
 		}
-		
-		++BlobIdx;
-	}
-	
-	// Disable any extras
-	for (; BlobIdx < BlobActors.Num(); ++BlobIdx)
-	{
-		BlobActors[BlobIdx]->SetActorHiddenInGame(true);
 	}
 }
 
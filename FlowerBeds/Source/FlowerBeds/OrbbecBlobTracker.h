@@ -2,6 +2,8 @@
 
 #include "CoreMinimal.h"
 #include "IIVision/BlobTracker.h"
+#include "IIVision/DepthRecording.h"
+#include "IIVision/VisionWorker.h"
 
 #include "OrbbecBlobTracker.generated.h"
 
@@ -51,12 +53,32 @@ public:
 	
 	FOnBlobDetectionResult OnBlobDetectionResult;
 	
+	DECLARE_MULTICAST_DELEGATE_TwoParams(
+		FOnDepthFrameCaptured,
+		const AOrbbecBlobTracker*,
+		const II::Vision::FFramePacket&);
+	
+	/**
+	 * If bound, depth frames from the camera or replay go here rather than straight to detection, and whoever's
+	 * bound hands them back with PushDepthFrame. Lets frames from several cameras be lined up first.
+	 * Lockstep replay skips this, as it has to see every frame through.
+	 */
+	FOnDepthFrameCaptured OnDepthFrameCaptured;
+	
 	AOrbbecBlobTracker();
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	
+	// Shows the frame and hands it to the vision worker for detection
+	void PushDepthFrame(const II::Vision::FFramePacket& DepthFrame);
 
 private:
-	II::Vision::FBlobTracker BlobTracker;
+	// Calibration and detection run on here, off the game thread
+	TUniquePtr<II::Vision::FVisionWorker> VisionWorker;
+	
+	// The last background we uploaded to BlobBgVisualizer
+	TSharedPtr<const TArray<uint16>> VisualizedBackgroundDepthMm;
 	
 	UPROPERTY(Transient)
 	TObjectPtr<UOrbbecCameraController> CameraController;
@@ -64,11 +86,37 @@ private:
 	FDelegateHandle OnFramesReceivedDelegateHandle;
 	
 	void OnFramesReceived(const FOrbbecFrame& ColorFrame, const FOrbbecFrame& DepthFrame, const FOrbbecFrame& IRFrame);
+	void OnDepthFrame(const II::Vision::FFramePacket& DepthFrame);
+	void OnVisionOutput(const II::Vision::FVisionWorker::FOutput& Output);
+	
+	// Stands in for the camera when the config has a ReplayPath
+	TUniquePtr<II::Vision::FDepthRecordingReader> ReplayReader;
+	bool bReplayInLockstep = false;
+	bool bLoopReplay = false;
+	
+	// The next frame to hand over, and the wall clock and recorded times replay (re)started at, for pacing
+	II::Vision::FFramePacket NextReplayFrame{};
+	bool bHasNextReplayFrame = false;
+	double ReplayStartSeconds = 0.0;
+	uint64 ReplayStartTimestampUs = 0;
+	
+	// In lockstep, set while the worker's still on the last frame we handed over
+	bool bReplayFrameInFlight = false;
+	
+	void StartReplay(const FString& Path);
+	void TickReplay();
+	bool ReadReplayFrame();
 	
 	UPROPERTY(Transient)
 	TArray<TObjectPtr<AActor>> BlobActors;
 	
-	void UpdateWorldBlobs(const TArray<II::Vision::FBlobTracker::FBlob3D>& Blobs);
+	// Track id to index into BlobActors, so each person keeps the same actor for as long as they're tracked
+	TMap<int32, int32> TrackBlobActors;
+	
+	// Indices into BlobActors not assigned to a track, hidden
+	TArray<int32> FreeBlobActors;
+	
+	void UpdateWorldBlobs(const TArray<II::Vision::FBlobTracker::FTrack>& Tracks);
 	
 	void DrawBlobDebug(const FVector& WorldPos, const FVector& WorldHalfExtents) const;
 };
\ No newline at end of file
@@ -11,7 +11,11 @@ namespace II::Util
 		DepthFrame.Width = Frame.Config.Width;
 		DepthFrame.Height = Frame.Config.Height;
 		DepthFrame.TimestampUs = Frame.TimestampUs;
-		DepthFrame.Data = Frame.Data;
+		DepthFrame.SystemTimestampUs = Frame.SystemTimestampUs;
+		DepthFrame.DepthMm = TConstArrayView<uint16>(
+			reinterpret_cast<const uint16*>(Frame.Data.GetData()), 
+			Frame.Data.Num() / sizeof(uint16));
+		DepthFrame.DataOwner = Frame.DataOwner;
 		DepthFrame.Intrinsics = { Frame.Config.Fx, Frame.Config.Fy, Frame.Config.Cx, Frame.Config.Cy };
 		return DepthFrame;
 	}
@@ -0,0 +1,201 @@
+﻿#include "TargetFusion.h"
+
+#include "FlowerBeds.h"
+
+void FTargetFusion::SetSourceTracks(
+	const int32 SourceIdx,
+	const FTransform& CameraToWorld,
+	const TArray<FTrack>& Tracks,
+	const uint64 TimestampUs,
+	const double ReceivedSeconds)
+{
+	if (SourceIdx < 0 || SourceIdx >= MaxSources)
+	{
+		UE_LOG(LogFlowerBeds, Warning, TEXT("FTargetFusion: Camera %d is past the %d we can fuse, ignored"), SourceIdx, MaxSources);
+		return;
+	}
+	
+	if (SourceIdx >= Sources.Num())
+	{
+		Sources.SetNum(SourceIdx + 1);
+	}
+	
+	FSource& Source = Sources[SourceIdx];
+	Source.CameraToWorld = CameraToWorld;
+	Source.Tracks = Tracks;
+	Source.TimestampUs = TimestampUs;
+	Source.ReceivedSeconds = ReceivedSeconds;
+	
+	bHasNewTracks = true;
+}
+
+bool FTargetFusion::Fuse(const double NowSeconds, const double LookAheadSeconds, TArray<FVector>& OutTargets)
+{
+	// Cameras that have gone quiet drop out even if nobody else sends anything, so their people don't linger
+	uint64 FreshSourceMask = 0;
+	
+	for (int32 SourceIdx = 0; SourceIdx < Sources.Num(); ++SourceIdx)
+	{
+		if (NowSeconds - Sources[SourceIdx].ReceivedSeconds <= MaxSourceAgeSeconds)
+		{
+			FreshSourceMask |= 1ull << SourceIdx;
+		}
+	}
+	
+	if (!bHasNewTracks && FreshSourceMask == FusedSourceMask)
+	{
+		return false;
+	}
+	
+	bHasNewTracks = false;
+	FusedSourceMask = FreshSourceMask;
+	
+	// Every camera's tracks, predicted to the same moment. Cameras' clocks aren't ours, so go from the frame's
+	// timestamp by however long ago it arrived.
+	Targets.Reset();
+	
+	for (int32 SourceIdx = 0; SourceIdx < Sources.Num(); ++SourceIdx)
+	{
+		if (!(FreshSourceMask & (1ull << SourceIdx)))
+		{
+			continue;
+		}
+		
+		const FSource& Source = Sources[SourceIdx];
+		const double AgeSeconds = NowSeconds - Source.ReceivedSeconds;
+		const uint64 PredictAtUs = Source.TimestampUs + static_cast<uint64>(FMath::Max(AgeSeconds + LookAheadSeconds, 0.0) * 1e6);
+		
+		for (const FTrack& Track : Source.Tracks)
+		{
+			const FVector CamPosCm = Track.PredictAt(PredictAtUs).GetWorldPosCm();
+			Targets.Add({ Source.CameraToWorld.TransformPosition(CamPosCm), SourceIdx });
+		}
+	}
+	
+	// Hash the targets. With cells as big as the merge radius, anything close enough to merge with a target is in
+	// the 3x3x3 cells around it.
+	const float MergeRadiusSquared = FMath::Square(MergeRadiusCm);
+	TargetGrid.Reset();
+	
+	for (int32 TargetIdx = 0; TargetIdx < Targets.Num(); ++TargetIdx)
+	{
+		TargetGrid.Add(GetCell(Targets[TargetIdx].PosCm), TargetIdx);
+	}
+	
+	Candidates.Reset();
+	
+	for (int32 TargetIdx = 0; TargetIdx < Targets.Num(); ++TargetIdx)
+	{
+		const FTarget& Target = Targets[TargetIdx];
+		const FIntVector Cell = GetCell(Target.PosCm);
+		
+		for (int32 dz = -1; dz <= 1; ++dz)
+		{
+			for (int32 dy = -1; dy <= 1; ++dy)
+			{
+				for (int32 dx = -1; dx <= 1; ++dx)
+				{
+					for (auto It = TargetGrid.CreateConstKeyIterator(Cell + FIntVector(dx, dy, dz)); It; ++It)
+					{
+						// Each pair once, and never two from the same camera
+						const int32 OtherIdx = It.Value();
+						
+						if (OtherIdx <= TargetIdx || Targets[OtherIdx].SourceIdx == Target.SourceIdx)
+						{
+							continue;
+						}
+						
+						const float DistSquared = FVector::DistSquared(Target.PosCm, Targets[OtherIdx].PosCm);
+						
+						if (DistSquared <= MergeRadiusSquared)
+						{
+							Candidates.Add({ DistSquared, TargetIdx, OtherIdx });
+						}
+					}
+				}
+			}
+		}
+	}
+	
+	// Merge closest pairs first, as long as the two clusters don't already have a target from the same camera
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B)
+	{
+		return A.DistSquared < B.DistSquared;
+	});
+	
+	ClusterParents.SetNumUninitialized(Targets.Num());
+	ClusterSourceMasks.SetNumUninitialized(Targets.Num());
+	
+	for (int32 TargetIdx = 0; TargetIdx < Targets.Num(); ++TargetIdx)
+	{
+		ClusterParents[TargetIdx] = TargetIdx;
+		ClusterSourceMasks[TargetIdx] = 1ull << Targets[TargetIdx].SourceIdx;
+	}
+	
+	for (const FCandidate& Candidate : Candidates)
+	{
+		const int32 ClusterA = FindCluster(Candidate.TargetIdxA);
+		const int32 ClusterB = FindCluster(Candidate.TargetIdxB);
+		
+		if (ClusterA == ClusterB || (ClusterSourceMasks[ClusterA] & ClusterSourceMasks[ClusterB]))
+		{
+			continue;
+		}
+		
+		ClusterParents[ClusterB] = ClusterA;
+		ClusterSourceMasks[ClusterA] |= ClusterSourceMasks[ClusterB];
+	}
+	
+	// One target per cluster, at the average of its targets
+	ClusterPosSums.Init(FVector::ZeroVector, Targets.Num());
+	ClusterSizes.Init(0, Targets.Num());
+	
+	for (int32 TargetIdx = 0; TargetIdx < Targets.Num(); ++TargetIdx)
+	{
+		const int32 Cluster = FindCluster(TargetIdx);
+		ClusterPosSums[Cluster] += Targets[TargetIdx].PosCm;
+		++ClusterSizes[Cluster];
+	}
+	
+	OutTargets.Reset();
+	
+	for (int32 Cluster = 0; Cluster < Targets.Num(); ++Cluster)
+	{
+		if (ClusterSizes[Cluster])
+		{
+			OutTargets.Add(ClusterPosSums[Cluster] / ClusterSizes[Cluster]);
+		}
+	}
+	
+	return true;
+}
+
+void FTargetFusion::Reset()
+{
+	Sources.Reset();
+	bHasNewTracks = false;
+	FusedSourceMask = 0;
+}
+
+FIntVector FTargetFusion::GetCell(const FVector& PosCm) const
+{
+	const double CellSizeCm = FMath::Max(MergeRadiusCm, 1.0f);
+	
+	return {
+		FMath::FloorToInt32(PosCm.X / CellSizeCm),
+		FMath::FloorToInt32(PosCm.Y / CellSizeCm),
+		FMath::FloorToInt32(PosCm.Z / CellSizeCm)
+	};
+}
+
+int32 FTargetFusion::FindCluster(int32 TargetIdx)
+{
+	while (ClusterParents[TargetIdx] != TargetIdx)
+	{
+		// Path halving keeps the chains short
+		ClusterParents[TargetIdx] = ClusterParents[ClusterParents[TargetIdx]];
+		TargetIdx = ClusterParents[TargetIdx];
+	}
+	
+	return TargetIdx;
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "IIVision/BlobTracker.h"
+
+/**
+ * Merges what every camera sees into one list of people, in world space.
+ * Each camera's latest tracks are kept until it sends newer ones. Fusing predicts every camera's tracks to the same
+ * moment, then clusters them: targets from different cameras within MergeRadiusCm of each other are taken to be the
+ * same person, closest pairs first, and never two targets from the same camera, as its tracker has already told
+ * those apart. Each cluster becomes one target at its average position.
+ * Pairs are found through a spatial hash with MergeRadiusCm cells, so fusing is linear in the number of targets.
+ */
+class FTargetFusion
+{
+public:
+	using FTrack = II::Vision::FBlobTracker::FTrack;
+	
+	// Up to this many cameras, so a cluster's cameras fit in a bitmask
+	static constexpr int32 MaxSources = 64;
+	
+	float MergeRadiusCm = 60.0f;
+	
+	// Cameras that haven't sent anything for this long are left out, rather than holding on to their last people
+	float MaxSourceAgeSeconds = 0.25f;
+	
+	/**
+	 * Replaces what we had from this camera. Tracks are in its camera space, CameraToWorld places them in the world.
+	 * TimestampUs is the frame's, on the camera's clock, and ReceivedSeconds when it reached us, on ours.
+	 */
+	void SetSourceTracks(
+		int32 SourceIdx,
+		const FTransform& CameraToWorld,
+		const TArray<FTrack>& Tracks,
+		uint64 TimestampUs,
+		double ReceivedSeconds);
+	
+	/**
+	 * Fuses the latest tracks from every camera, each predicted LookAheadSeconds past NowSeconds. Returns false, and
+	 * leaves OutTargets alone, if nothing new has arrived and no camera has aged out since the last time.
+	 */
+	bool Fuse(double NowSeconds, double LookAheadSeconds, TArray<FVector>& OutTargets);
+	
+	void Reset();
+
+private:
+	struct FSource
+	{
+		FTransform CameraToWorld = FTransform::Identity;
+		TArray<FTrack> Tracks;
+		uint64 TimestampUs = 0;
+		double ReceivedSeconds = 0.0;
+	};
+	
+	struct FTarget
+	{
+		FVector PosCm = FVector::ZeroVector;
+		int32 SourceIdx = INDEX_NONE;
+	};
+	
+	struct FCandidate
+	{
+		float DistSquared = 0.0f;
+		int32 TargetIdxA = INDEX_NONE;
+		int32 TargetIdxB = INDEX_NONE;
+	};
+	
+	TArray<FSource> Sources;
+	bool bHasNewTracks = false;
+	
+	// The cameras that went into the last fuse
+	uint64 FusedSourceMask = 0;
+	
+	// Scratch, kept between fuses for the allocations
+	TArray<FTarget> Targets;
+	TMultiMap<FIntVector, int32> TargetGrid;
+	TArray<FCandidate> Candidates;
+	TArray<int32> ClusterParents;
+	TArray<uint64> ClusterSourceMasks;
+	TArray<FVector> ClusterPosSums;
+	TArray<int32> ClusterSizes;
+	
+	FIntVector GetCell(const FVector& PosCm) const;
+	int32 FindCluster(int32 TargetIdx);
+};
@@ -0,0 +1,143 @@
+﻿#include "TargetGrid.h"
+
+namespace
+{
+	// Cells don't get any smaller than this, however tightly packed the targets
+	constexpr double MinCellSizeCm = 50.0;
+	
+	// Nor are there more than this many along a side, however spread out
+	constexpr int32 MaxCellsPerSide = 256;
+}
+
+void FTargetGrid::Build(const TConstArrayView<FVector> InTargets)
+{
+	Targets = InTargets;
+	CellStarts.Reset();
+	CellTargets.Reset();
+	NumCellsX = 0;
+	NumCellsY = 0;
+	
+	if (Targets.IsEmpty())
+	{
+		return;
+	}
+	
+	FBox2D Bounds(ForceInit);
+	
+	for (const FVector& Target : Targets)
+	{
+		Bounds += FVector2D(Target);
+	}
+	
+	// About one target per cell
+	const FVector2D Size = Bounds.GetSize();
+	CellSizeCm = FMath::Max3(FMath::Sqrt(Size.X * Size.Y / Targets.Num()), MinCellSizeCm, Size.GetMax() / MaxCellsPerSide);
+	MinCm = Bounds.Min;
+	NumCellsX = FMath::FloorToInt32(Size.X / CellSizeCm) + 1;
+	NumCellsY = FMath::FloorToInt32(Size.Y / CellSizeCm) + 1;
+	
+	// Counting sort by cell
+	CellStarts.SetNumZeroed(NumCellsX * NumCellsY + 1);
+	
+	for (const FVector& Target : Targets)
+	{
+		const FIntPoint Cell = GetCell(Target);
+		++CellStarts[Cell.Y * NumCellsX + Cell.X + 1];
+	}
+	
+	for (int32 Cell = 1; Cell < CellStarts.Num(); ++Cell)
+	{
+		CellStarts[Cell] += CellStarts[Cell - 1];
+	}
+	
+	CellTargets.SetNumUninitialized(Targets.Num());
+	TArray<int32, TInlineAllocator<64>> CellFill;
+	CellFill.Append(CellStarts.GetData(), CellStarts.Num() - 1);
+	
+	for (int32 TargetIdx = 0; TargetIdx < Targets.Num(); ++TargetIdx)
+	{
+		const FIntPoint Cell = GetCell(Targets[TargetIdx]);
+		CellTargets[CellFill[Cell.Y * NumCellsX + Cell.X]++] = TargetIdx;
+	}
+}
+
+int32 FTargetGrid::FindClosest(const FVector& PosCm) const
+{
+	if (Targets.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+	
+	// The query may be outside the grid, so rings closer in than the grid's edge are empty and skipped
+	const int32 QueryX = FMath::FloorToInt32((PosCm.X - MinCm.X) / CellSizeCm);
+	const int32 QueryY = FMath::FloorToInt32((PosCm.Y - MinCm.Y) / CellSizeCm);
+	const int32 FirstRing = FMath::Max3(
+		FMath::Max(-QueryX, QueryX - (NumCellsX - 1)),
+		FMath::Max(-QueryY, QueryY - (NumCellsY - 1)),
+		0);
+	const int32 LastRing = FMath::Max(
+		FMath::Max(FMath::Abs(QueryX), FMath::Abs(QueryX - (NumCellsX - 1))),
+		FMath::Max(FMath::Abs(QueryY), FMath::Abs(QueryY - (NumCellsY - 1))));
+	
+	int32 ClosestIdx = INDEX_NONE;
+	double ClosestDistSquared = TNumericLimits<double>::Max();
+	
+	const auto SearchCell = [&](const int32 x, const int32 y)
+	{
+		if (x < 0 || x >= NumCellsX || y < 0 || y >= NumCellsY)
+		{
+			return;
+		}
+		
+		const int32 Cell = y * NumCellsX + x;
+		
+		for (int32 Idx = CellStarts[Cell]; Idx < CellStarts[Cell + 1]; ++Idx)
+		{
+			const int32 TargetIdx = CellTargets[Idx];
+			const double DistSquared = FVector::DistSquared(PosCm, Targets[TargetIdx]);
+			
+			if (DistSquared < ClosestDistSquared)
+			{
+				ClosestDistSquared = DistSquared;
+				ClosestIdx = TargetIdx;
+			}
+		}
+	};
+	
+	for (int32 Ring = FirstRing; Ring <= LastRing; ++Ring)
+	{
+		// Everything outside this ring is at least Ring cells away across the ground, and further still in 3D
+		if (ClosestIdx != INDEX_NONE && ClosestDistSquared <= FMath::Square((Ring - 1) * CellSizeCm))
+		{
+			break;
+		}
+		
+		if (Ring == 0)
+		{
+			SearchCell(QueryX, QueryY);
+			continue;
+		}
+		
+		for (int32 x = QueryX - Ring; x <= QueryX + Ring; ++x)
+		{
+			SearchCell(x, QueryY - Ring);
+			SearchCell(x, QueryY + Ring);
+		}
+		
+		for (int32 y = QueryY - Ring + 1; y <= QueryY + Ring - 1; ++y)
+		{
+			SearchCell(QueryX - Ring, y);
+			SearchCell(QueryX + Ring, y);
+		}
+	}
+	
+	return ClosestIdx;
+}
+
+FIntPoint FTargetGrid::GetCell(const FVector& PosCm) const
+{
+	return {
+		FMath::Clamp(FMath::FloorToInt32((PosCm.X - MinCm.X) / CellSizeCm), 0, NumCellsX - 1),
+		FMath::Clamp(FMath::FloorToInt32((PosCm.Y - MinCm.Y) / CellSizeCm), 0, NumCellsY - 1)
+	};
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Finds the closest of a set of targets to a point, for every flower cluster in turn.
+ * Targets are bucketed into a uniform grid in the ground plane, sized to have about one target per cell, by a
+ * counting sort into one flat array. A query searches rings of cells outward from its own until nothing further out
+ * could be closer than what it's found. Rebuilt per update, which is cheap next to querying it for every cluster.
+ */
+class FTargetGrid
+{
+public:
+	void Build(TConstArrayView<FVector> InTargets);
+	
+	// Index of the closest target to PosCm, in 3D, or INDEX_NONE if there are none
+	int32 FindClosest(const FVector& PosCm) const;
+
+private:
+	TConstArrayView<FVector> Targets;
+	
+	FVector2D MinCm = FVector2D::ZeroVector;
+	double CellSizeCm = 1.0;
+	int32 NumCellsX = 0;
+	int32 NumCellsY = 0;
+	
+	// Targets sorted by cell, with each cell's run in there starting at CellStarts[Cell] and ending at the next
+	TArray<int32> CellStarts;
+	TArray<int32> CellTargets;
+	
+	FIntPoint GetCell(const FVector& PosCm) const;
+};